@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+# HTTP/2 (h2c) против HTTP/1.1 при одинаковом числе запросов в полёте.
+# HTTP/2: одно соединение, -m потоков за раз; HTTP/1.1: -m keep-alive
+# соединений по одному запросу. Замеряется раунд "отправить -m запросов,
+# дождаться всех ответов". Внешние зависимости не нужны. Пример:
+#   ./server
+#   python3 bench/h2_multiplex.py --port 8080 -m 16 -n 20000
+#   python3 bench/h2_multiplex.py --path /s/big.bin -m 8 -n 200
+import argparse
+import re
+import socket
+import struct
+import time
+
+PREFACE = b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+DATA, HEADERS, RST_STREAM, SETTINGS, PING, GOAWAY, WINDOW_UPDATE = 0, 1, 3, 4, 6, 7, 8
+END_STREAM, ACK = 0x1, 0x1
+MAX_WINDOW = 2**31 - 1
+CONTENT_LENGTH = re.compile(rb"content-length:\s*(\d+)", re.IGNORECASE)
+
+
+def frame(kind, flags, stream_id, payload=b""):
+    return struct.pack(">I", len(payload))[1:] + bytes((kind, flags)) + \
+        struct.pack(">I", stream_id) + payload
+
+
+def hpack_int(value, prefix_bits, first=0):
+    limit = (1 << prefix_bits) - 1
+    if value < limit:
+        return bytes((first | value,))
+    out = bytearray((first | limit,))
+    value -= limit
+    while value >= 128:
+        out.append(value % 128 + 128)
+        value //= 128
+    out.append(value)
+    return bytes(out)
+
+
+def hpack_literal(name, value):
+    # Литерал без индексации, имя тоже литералом, без Хаффмана
+    return b"\x00" + hpack_int(len(name), 7) + name + hpack_int(len(value), 7) + value
+
+
+class H2Connection:
+    def __init__(self, address):
+        self.sock = socket.create_connection(address)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.buffer = b""
+        self.next_id = 1
+        # Окно потока - максимум, окно соединения пополняется по мере DATA
+        settings = struct.pack(">HI", 0x4, MAX_WINDOW)
+        self.sock.sendall(PREFACE + frame(SETTINGS, 0, 0, settings) +
+                          frame(WINDOW_UPDATE, 0, 0, struct.pack(">I", MAX_WINDOW - 65535)))
+
+    def read_frame(self):
+        while len(self.buffer) < 9:
+            self.fill()
+        length = int.from_bytes(self.buffer[:3], "big")
+        kind, flags = self.buffer[3], self.buffer[4]
+        stream_id = int.from_bytes(self.buffer[5:9], "big") & 0x7fffffff
+        while len(self.buffer) < 9 + length:
+            self.fill()
+        payload = self.buffer[9:9 + length]
+        self.buffer = self.buffer[9 + length:]
+        return kind, flags, stream_id, payload
+
+    def fill(self):
+        chunk = self.sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed")
+        self.buffer += chunk
+
+    def round(self, host, path, count):
+        block = hpack_literal(b":method", b"GET") + hpack_literal(b":scheme", b"http") + \
+            hpack_literal(b":path", path) + hpack_literal(b":authority", host)
+        pending = set()
+        out = b""
+        for _ in range(count):
+            out += frame(HEADERS, END_STREAM | 0x4, self.next_id, block)
+            pending.add(self.next_id)
+            self.next_id += 2
+        self.sock.sendall(out)
+
+        received = 0
+        while pending:
+            kind, flags, stream_id, payload = self.read_frame()
+            if kind == DATA and payload:
+                received += len(payload)
+                self.sock.sendall(frame(WINDOW_UPDATE, 0, 0, struct.pack(">I", len(payload))))
+            elif kind == SETTINGS and not flags & ACK:
+                self.sock.sendall(frame(SETTINGS, ACK, 0))
+            elif kind == PING and not flags & ACK:
+                self.sock.sendall(frame(PING, ACK, 0, payload))
+            elif kind == GOAWAY:
+                raise ConnectionError("GOAWAY received")
+            elif kind == RST_STREAM:
+                raise ConnectionError(f"stream {stream_id} reset")
+            if kind in (DATA, HEADERS) and flags & END_STREAM:
+                pending.discard(stream_id)
+        return received
+
+    def close(self):
+        self.sock.close()
+
+
+def read_response(sock, buffer):
+    while b"\r\n\r\n" not in buffer:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed before headers")
+        buffer += chunk
+    head, buffer = buffer.split(b"\r\n\r\n", 1)
+    match = CONTENT_LENGTH.search(head)
+    length = int(match.group(1)) if match else 0
+    while len(buffer) < length:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed before body")
+        buffer += chunk
+    return length, buffer[length:]
+
+
+def bench_h1(args, address):
+    request = b"GET %s HTTP/1.1\r\nHost: bench\r\n\r\n" % args.path.encode()
+
+    def connect():
+        sock = socket.create_connection(address)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        return [sock, b""]
+
+    socks = [connect() for _ in range(args.concurrency)]
+    latencies = []
+    total = 0
+    rounds = args.requests // args.concurrency
+    start = time.perf_counter()
+    for i in range(rounds):
+        # Соединение переоткрывается до лимита запросов сервера
+        if i and i % args.per_connection == 0:
+            for entry in socks:
+                entry[0].close()
+            socks = [connect() for _ in range(args.concurrency)]
+        round_start = time.perf_counter()
+        for sock, _ in socks:
+            sock.sendall(request)
+        for entry in socks:
+            length, entry[1] = read_response(entry[0], entry[1])
+            total += length
+        latencies.append(time.perf_counter() - round_start)
+    elapsed = time.perf_counter() - start
+    for sock, _ in socks:
+        sock.close()
+    return rounds * args.concurrency, elapsed, total, latencies
+
+
+def bench_h2(args, address):
+    connection = H2Connection(address)
+    host = args.host.encode()
+    latencies = []
+    total = 0
+    rounds = args.requests // args.concurrency
+    start = time.perf_counter()
+    for _ in range(rounds):
+        round_start = time.perf_counter()
+        total += connection.round(host, args.path.encode(), args.concurrency)
+        latencies.append(time.perf_counter() - round_start)
+    elapsed = time.perf_counter() - start
+    connection.close()
+    return rounds * args.concurrency, elapsed, total, latencies
+
+
+def main():
+    parser = argparse.ArgumentParser(description="HTTP/2 multiplexing vs HTTP/1.1 keep-alive")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--path", default="/")
+    parser.add_argument("-n", "--requests", type=int, default=10000)
+    parser.add_argument("-m", "--concurrency", type=int, default=16,
+                        help="streams in flight (h2) / connections (h1)")
+    parser.add_argument("--per-connection", type=int, default=9,
+                        help="HTTP/1.1 requests before reconnecting")
+    args = parser.parse_args()
+
+    address = (args.host, args.port)
+    for name, bench in (("http/1.1", bench_h1), ("h2c", bench_h2)):
+        requests, elapsed, total, latencies = bench(args, address)
+        latencies.sort()
+        p50, p99 = (latencies[int(len(latencies) * q)] * 1e6 for q in (0.5, 0.99))
+        print(f"{name:8} {requests / elapsed:8.0f} req/s  {total / elapsed / 1e6:7.1f} MB/s  "
+              f"round p50 {p50:8.1f} us  p99 {p99:8.1f} us")
+
+
+if __name__ == "__main__":
+    main()
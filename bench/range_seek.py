@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+# Пропускная способность Range-запросов со случайными смещениями в файле:
+# каждый запрос - новая позиция, то есть pread/sendfile без упреждения.
+# С --check тело каждого ответа 206 сверяется с локальной копией. Пример:
+#   head -c 5000000 /dev/urandom > /tmp/www/big.bin
+#   SERVER_STATIC_ROOT=/tmp/www SERVER_STATIC_PREFIX=/s/ ./server
+#   python3 bench/range_seek.py --file /tmp/www/big.bin --path /s/big.bin --check
+import argparse
+import os
+import random
+import re
+import socket
+import time
+
+CONTENT_LENGTH = re.compile(rb"content-length:\s*(\d+)", re.IGNORECASE)
+
+
+def read_response(sock, buffer):
+    while b"\r\n\r\n" not in buffer:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed before headers")
+        buffer += chunk
+    head, buffer = buffer.split(b"\r\n\r\n", 1)
+    match = CONTENT_LENGTH.search(head)
+    length = int(match.group(1)) if match else 0
+    while len(buffer) < length:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed before body")
+        buffer += chunk
+    return head, buffer[:length], buffer[length:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Random-seek Range request throughput")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--path", default="/big.bin", help="URL of the file")
+    parser.add_argument("--file", required=True, help="local copy: size and --check")
+    parser.add_argument("-n", "--requests", type=int, default=2000)
+    parser.add_argument("--max-range", type=int, default=4096, help="largest range, bytes")
+    parser.add_argument("--per-connection", type=int, default=9)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--check", action="store_true", help="compare bodies with --file")
+    args = parser.parse_args()
+
+    size = os.path.getsize(args.file)
+    data = open(args.file, "rb").read() if args.check else None
+    rng = random.Random(args.seed)
+
+    sock = None
+    buffer = b""
+    total = 0
+    start = time.perf_counter()
+    for i in range(args.requests):
+        if i % args.per_connection == 0:
+            if sock:
+                sock.close()
+            sock = socket.create_connection((args.host, args.port))
+            buffer = b""
+        first = rng.randrange(size)
+        last = min(size - 1, first + rng.randrange(1, args.max_range))
+        sock.sendall(b"GET %s HTTP/1.1\r\nHost: bench\r\nRange: bytes=%d-%d\r\n\r\n"
+                     % (args.path.encode(), first, last))
+        head, body, buffer = read_response(sock, buffer)
+        total += len(body)
+        if args.check:
+            if not head.startswith(b"HTTP/1.1 206"):
+                raise SystemExit(f"unexpected status: {head.splitlines()[0]!r}")
+            if body != data[first:last + 1]:
+                raise SystemExit(f"body mismatch for bytes={first}-{last}")
+    sock.close()
+
+    elapsed = time.perf_counter() - start
+    print(f"{args.requests} requests, {args.requests / elapsed:.0f} req/s, "
+          f"{total / elapsed / 1e6:.1f} MB/s")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+# Пропускная способность при разных режимах шардирования рабочего пула.
+# Сервер перезапускается для каждого режима из --modes с одинаковыми
+# SERVER_REACTOR_CPUS/SERVER_WORKER_CPUS, клиенты в отдельных процессах
+# держат keep-alive соединения. Пример:
+#   python3 bench/shard_locality.py --server ./build/server \
+#       --reactor-cpus 0 --worker-cpus 1-7 --modes none,node,core -c 32
+# Рядом полезно смотреть perf stat -e node-load-misses (см. README).
+import argparse
+import multiprocessing
+import os
+import re
+import socket
+import subprocess
+import time
+
+CONTENT_LENGTH = re.compile(rb"content-length:\s*(\d+)", re.IGNORECASE)
+
+
+def read_response(sock, buffer):
+    while b"\r\n\r\n" not in buffer:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed before headers")
+        buffer += chunk
+    head, buffer = buffer.split(b"\r\n\r\n", 1)
+    match = CONTENT_LENGTH.search(head)
+    length = int(match.group(1)) if match else 0
+    while len(buffer) < length:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed before body")
+        buffer += chunk
+    return buffer[length:]
+
+
+def client(address, path, connections, per_connection, duration, results):
+    request = b"GET %s HTTP/1.1\r\nHost: bench\r\n\r\n" % path.encode()
+
+    def connect():
+        sock = socket.create_connection(address)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        return [sock, b""]
+
+    # Соединения переоткрываются до лимита запросов сервера, поэтому
+    # шард выбирается заново и в замер входит accept
+    socks = [connect() for _ in range(connections)]
+    latencies = []
+    rounds = 0
+    deadline = time.perf_counter() + duration
+    while time.perf_counter() < deadline:
+        # По запросу на каждое соединение процесса, затем ответы
+        start = time.perf_counter()
+        for sock, _ in socks:
+            sock.sendall(request)
+        for entry in socks:
+            entry[1] = read_response(entry[0], entry[1])
+        latencies.append(time.perf_counter() - start)
+        rounds += 1
+        if rounds % per_connection == 0:
+            for entry in socks:
+                entry[0].close()
+            socks = [connect() for _ in range(connections)]
+    for sock, _ in socks:
+        sock.close()
+    results.put((len(latencies) * connections, latencies))
+
+
+def wait_listening(address, timeout=5.0):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            socket.create_connection(address).close()
+            return
+        except OSError:
+            time.sleep(0.05)
+    raise SystemExit(f"server did not start on {address[0]}:{address[1]}")
+
+
+def run_mode(args, mode):
+    env = dict(os.environ,
+               SERVER_LISTEN=f"{args.host}:{args.port}",
+               SERVER_SHARDING=mode,
+               SERVER_MATCH_INCOMING_CPU="1" if args.incoming_cpu else "0")
+    if args.reactor_cpus:
+        env["SERVER_REACTOR_CPUS"] = args.reactor_cpus
+    if args.worker_cpus:
+        env["SERVER_WORKER_CPUS"] = args.worker_cpus
+    server = subprocess.Popen([args.server], env=env,
+                              stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        address = (args.host, args.port)
+        wait_listening(address)
+        results = multiprocessing.Queue()
+        per_process = max(1, args.connections // args.processes)
+        clients = [multiprocessing.Process(target=client,
+                                           args=(address, args.path, per_process,
+                                                 args.per_connection, args.duration,
+                                                 results))
+                   for _ in range(args.processes)]
+        for process in clients:
+            process.start()
+        requests = 0
+        latencies = []
+        for _ in clients:
+            count, batch = results.get()
+            requests += count
+            latencies += batch
+        for process in clients:
+            process.join()
+    finally:
+        server.terminate()
+        server.wait()
+
+    latencies.sort()
+    p50, p99 = (latencies[int(len(latencies) * q)] * 1e6 for q in (0.5, 0.99))
+    print(f"{mode:5} {requests / args.duration:9.0f} req/s  "
+          f"round p50 {p50:8.1f} us  p99 {p99:8.1f} us")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Worker shard locality throughput")
+    parser.add_argument("--server", required=True, help="server binary")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--path", default="/")
+    parser.add_argument("--modes", default="none,node,core", help="SERVER_SHARDING values")
+    parser.add_argument("--reactor-cpus", default="", help="SERVER_REACTOR_CPUS")
+    parser.add_argument("--worker-cpus", default="", help="SERVER_WORKER_CPUS, required for node/core")
+    parser.add_argument("--incoming-cpu", action="store_true",
+                        help="SERVER_MATCH_INCOMING_CPU=1")
+    parser.add_argument("-c", "--connections", type=int, default=32)
+    parser.add_argument("--per-connection", type=int, default=9)
+    parser.add_argument("-p", "--processes", type=int, default=os.cpu_count() or 4)
+    parser.add_argument("-d", "--duration", type=float, default=5.0, help="seconds per mode")
+    args = parser.parse_args()
+
+    for mode in args.modes.split(","):
+        run_mode(args, mode.strip())
+
+
+if __name__ == "__main__":
+    main()
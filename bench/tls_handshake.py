@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+# Рукопожатия TLS в секунду: полные и с возобновлением сессии (тикет
+# в TLS 1.3, тикет или ID сессии в TLS 1.2), плюс задержка первого байта
+# тела в зависимости от размера записей: на холодном соединении записи
+# по 1400 байт, после --warm-path (больше 1 МБ) - крупные. Пример:
+#   SERVER_STATIC_ROOT=/tmp/www SERVER_STATIC_PREFIX=/s/ \
+#   SERVER_TLS_CERT=cert.pem SERVER_TLS_KEY=key.pem ./server
+#   python3 bench/tls_handshake.py --port 8080 -n 500
+#   python3 bench/tls_handshake.py --port 8080 --record-path /s/a.txt --warm-path /s/big.bin
+import argparse
+import re
+import socket
+import ssl
+import time
+
+CONTENT_LENGTH = re.compile(rb"content-length:\s*(\d+)", re.IGNORECASE)
+
+
+def make_context(tls12):
+    context = ssl.create_default_context()
+    # Самоподписанный сертификат тестового сервера
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+    context.set_alpn_protocols(["http/1.1"])
+    if tls12:
+        context.maximum_version = ssl.TLSVersion.TLSv1_2
+    return context
+
+
+def connect(context, address, session=None):
+    raw = socket.create_connection(address)
+    raw.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    return context.wrap_socket(raw, server_hostname=address[0], session=session)
+
+
+def request(sock, path, on_first_byte=None):
+    sock.sendall(b"GET %s HTTP/1.1\r\nHost: bench\r\n\r\n" % path.encode())
+    data = b""
+    while b"\r\n\r\n" not in data:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed before headers")
+        data += chunk
+    head, body = data.split(b"\r\n\r\n", 1)
+    match = CONTENT_LENGTH.search(head)
+    length = int(match.group(1)) if match else 0
+    while not body and length:
+        body = sock.recv(65536)
+        if not body:
+            raise ConnectionError("connection closed before body")
+    if on_first_byte:
+        on_first_byte()
+    while len(body) < length:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise ConnectionError("connection closed before body")
+        body += chunk
+
+
+def bench_handshakes(args, address, context, resume):
+    # Сессия для возобновления: в TLS 1.3 тикет приходит после
+    # рукопожатия, поэтому сначала один запрос
+    session = None
+    if resume:
+        sock = connect(context, address)
+        request(sock, "/")
+        session = sock.session
+        sock.close()
+
+    reused = 0
+    latencies = []
+    for _ in range(args.handshakes):
+        handshake_start = time.perf_counter()
+        sock = connect(context, address, session)
+        latencies.append(time.perf_counter() - handshake_start)
+        if sock.session_reused:
+            reused += 1
+        if resume:
+            # Свежий тикет (TLS 1.3 выдаёт одноразовые) для следующего раза
+            request(sock, "/")
+            session = sock.session
+        sock.close()
+
+    # Темп по времени самих рукопожатий: запрос за тикетом не входит
+    rate = len(latencies) / sum(latencies)
+    latencies.sort()
+    p50, p99 = (latencies[int(len(latencies) * q)] * 1e6 for q in (0.5, 0.99))
+    name = "resumed" if resume else "full"
+    print(f"{name:8} {rate:7.0f} handshakes/s  p50 {p50:8.1f} us  "
+          f"p99 {p99:8.1f} us  reused {reused}/{args.handshakes}")
+
+
+def bench_records(args, address, context):
+    cold = []
+    warm = []
+    for _ in range(args.rounds):
+        for warmed, results in ((False, cold), (True, warm)):
+            sock = connect(context, address)
+            if warmed:
+                # Больше 1 МБ отправлено - сервер переходит на крупные записи
+                request(sock, args.warm_path)
+            start = time.perf_counter()
+            first = []
+            request(sock, args.record_path, lambda: first.append(time.perf_counter()))
+            results.append((first[0] - start, time.perf_counter() - start))
+            sock.close()
+
+    for name, results in (("cold", cold), ("warm", warm)):
+        first = sorted(r[0] for r in results)
+        last = sorted(r[1] for r in results)
+        print(f"{name:5} first byte p50 {first[len(first) // 2] * 1e6:8.1f} us  "
+              f"last byte p50 {last[len(last) // 2] * 1e6:8.1f} us")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="TLS handshake rate and record-size latency")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8443)
+    parser.add_argument("-n", "--handshakes", type=int, default=500)
+    parser.add_argument("--tls12", action="store_true", help="limit to TLS 1.2")
+    parser.add_argument("--record-path", help="response timed on cold and warm connections")
+    parser.add_argument("--warm-path", help="response over 1 MB that warms a connection")
+    parser.add_argument("--rounds", type=int, default=50)
+    args = parser.parse_args()
+
+    address = (args.host, args.port)
+    context = make_context(args.tls12)
+    if args.record_path:
+        if not args.warm_path:
+            raise SystemExit("--record-path needs --warm-path")
+        bench_records(args, address, context)
+        return
+    bench_handshakes(args, address, context, resume=False)
+    bench_handshakes(args, address, context, resume=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# Задержка запроса через Unix-сокет и через loopback TCP.
+# Каждые --per-connection запросов соединение переоткрывается, поэтому в
+# замер входит и accept. Пример:
+#   SERVER_LISTEN="127.0.0.1:8080, unix:/tmp/server.sock" ./server
+#   python3 bench/uds_latency.py --tcp 127.0.0.1:8080 --unix /tmp/server.sock
+import argparse
+import socket
+import time
+
+REQUEST = b"GET / HTTP/1.1\r\nHost: bench\r\n\r\n"
+
+
+def read_response(sock):
+    data = b""
+    while b"\r\n\r\n" not in data:
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise ConnectionError("connection closed before headers")
+        data += chunk
+    head, body = data.split(b"\r\n\r\n", 1)
+    length = 0
+    for line in head.split(b"\r\n")[1:]:
+        name, _, value = line.partition(b":")
+        if name.strip().lower() == b"content-length":
+            length = int(value)
+    while len(body) < length:
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise ConnectionError("connection closed before body")
+        body += chunk
+
+
+def bench(connect, requests, per_connection):
+    latencies = []
+    sock = connect()
+    for i in range(requests):
+        start = time.perf_counter()
+        sock.sendall(REQUEST)
+        read_response(sock)
+        latencies.append(time.perf_counter() - start)
+        if (i + 1) % per_connection == 0:
+            sock.close()
+            sock = connect()
+    sock.close()
+    latencies.sort()
+    return [latencies[int(len(latencies) * q)] * 1e6 for q in (0.5, 0.99)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Unix socket vs loopback TCP latency")
+    parser.add_argument("--tcp", default="127.0.0.1:8080", help="host:port")
+    parser.add_argument("--unix", default="/tmp/server.sock", help="socket path")
+    parser.add_argument("-n", "--requests", type=int, default=5000)
+    parser.add_argument("--per-connection", type=int, default=5)
+    args = parser.parse_args()
+
+    host, _, port = args.tcp.rpartition(":")
+
+    def tcp():
+        sock = socket.create_connection((host, int(port)))
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        return sock
+
+    def unix():
+        sock = socket.socket(socket.AF_UNIX)
+        sock.connect(args.unix)
+        return sock
+
+    for name, connect in (("tcp", tcp), ("unix", unix)):
+        p50, p99 = bench(connect, args.requests, args.per_connection)
+        print(f"{name:5} p50 {p50:7.1f} us  p99 {p99:7.1f} us")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+# Рассылка WebSocket: N подписчиков одной темы, первый из них публикует.
+# Сообщение несёт номер; задержка доставки - от отправки до приёма
+# каждым подписчиком (часы одного процесса). --window сообщений в полёте.
+# Сервер должен рассылать сообщения, а не отвечать эхом. Пример:
+#   SERVER_WS_BROADCAST=1 SERVER_MAX_CONNECTIONS=2000 ./server
+#   python3 bench/ws_fanout.py --port 8080 -c 1000 -n 200 --window 4
+import argparse
+import base64
+import os
+import selectors
+import socket
+import struct
+import time
+
+WS_TEXT, WS_CLOSE, WS_PING, WS_PONG = 0x1, 0x8, 0x9, 0xA
+
+
+def client_frame(opcode, payload):
+    # Кадры клиента маскируются (RFC 6455 §5.3)
+    mask = os.urandom(4)
+    header = bytes((0x80 | opcode,))
+    if len(payload) < 126:
+        header += bytes((0x80 | len(payload),))
+    elif len(payload) < 65536:
+        header += bytes((0x80 | 126,)) + struct.pack(">H", len(payload))
+    else:
+        header += bytes((0x80 | 127,)) + struct.pack(">Q", len(payload))
+    keystream = (mask * (len(payload) // 4 + 1))[:len(payload)]
+    masked = (int.from_bytes(payload, "big") ^ int.from_bytes(keystream, "big")).to_bytes(
+        len(payload), "big")
+    return header + mask + masked
+
+
+def connect(address, path):
+    sock = socket.create_connection(address)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    key = base64.b64encode(os.urandom(16))
+    sock.sendall(b"GET %s HTTP/1.1\r\nHost: bench\r\nUpgrade: websocket\r\n"
+                 b"Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\n"
+                 b"Sec-WebSocket-Version: 13\r\n\r\n" % (path.encode(), key))
+    data = b""
+    while b"\r\n\r\n" not in data:
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise ConnectionError("connection closed during handshake")
+        data += chunk
+    head, rest = data.split(b"\r\n\r\n", 1)
+    if not head.startswith(b"HTTP/1.1 101"):
+        raise SystemExit(f"upgrade failed: {head.splitlines()[0]!r}")
+    sock.setblocking(False)
+    return sock, rest
+
+
+def parse_frames(buffer):
+    """Целые кадры сервера (без маски) и остаток буфера."""
+    frames = []
+    while len(buffer) >= 2:
+        opcode = buffer[0] & 0x0F
+        length = buffer[1] & 0x7F
+        offset = 2
+        if length == 126:
+            if len(buffer) < 4:
+                break
+            length = struct.unpack(">H", buffer[2:4])[0]
+            offset = 4
+        elif length == 127:
+            if len(buffer) < 10:
+                break
+            length = struct.unpack(">Q", buffer[2:10])[0]
+            offset = 10
+        if len(buffer) < offset + length:
+            break
+        frames.append((opcode, buffer[offset:offset + length]))
+        buffer = buffer[offset + length:]
+    return frames, buffer
+
+
+def main():
+    parser = argparse.ArgumentParser(description="WebSocket broadcast fan-out latency and throughput")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--path", default="/bench", help="topic")
+    parser.add_argument("-c", "--subscribers", type=int, default=100)
+    parser.add_argument("-n", "--messages", type=int, default=200)
+    parser.add_argument("--window", type=int, default=1, help="messages in flight")
+    parser.add_argument("--size", type=int, default=64, help="payload bytes")
+    args = parser.parse_args()
+
+    address = (args.host, args.port)
+    selector = selectors.DefaultSelector()
+    buffers = {}
+    socks = []
+    for _ in range(args.subscribers):
+        sock, rest = connect(address, args.path)
+        socks.append(sock)
+        buffers[sock] = rest
+        selector.register(sock, selectors.EVENT_READ)
+    publisher = socks[0]
+    publisher.setblocking(True)
+
+    sent_at = {}
+    remaining = {}
+    delivery = []
+    last_delivery = []
+    next_seq = 0
+    done = 0
+    padding = b"x" * max(0, args.size - 12)
+
+    def publish():
+        nonlocal next_seq
+        payload = b"%012d" % next_seq + padding
+        sent_at[next_seq] = time.perf_counter()
+        remaining[next_seq] = args.subscribers
+        publisher.sendall(client_frame(WS_TEXT, payload))
+        next_seq += 1
+
+    start = time.perf_counter()
+    while next_seq < min(args.window, args.messages):
+        publish()
+    while done < args.messages:
+        events = selector.select(timeout=5)
+        if not events:
+            raise SystemExit(f"timed out: {done}/{args.messages} messages fully delivered")
+        now = time.perf_counter()
+        for key, _ in events:
+            sock = key.fileobj
+            try:
+                chunk = sock.recv(262144)
+            except BlockingIOError:
+                continue
+            if not chunk:
+                raise SystemExit("server closed a subscriber")
+            frames, buffers[sock] = parse_frames(buffers[sock] + chunk)
+            for opcode, payload in frames:
+                if opcode == WS_PING:
+                    # Понг мал и помещается в буфер сокета
+                    sock.send(client_frame(WS_PONG, payload))
+                    continue
+                if opcode == WS_CLOSE:
+                    code = struct.unpack(">H", payload[:2])[0] if len(payload) >= 2 else 0
+                    raise SystemExit(f"server closed a subscriber with {code}")
+                if opcode != WS_TEXT:
+                    continue
+                seq = int(payload[:12])
+                delivery.append(now - sent_at[seq])
+                remaining[seq] -= 1
+                if remaining[seq] == 0:
+                    last_delivery.append(now - sent_at.pop(seq))
+                    del remaining[seq]
+                    done += 1
+                    if next_seq < args.messages:
+                        publish()
+    elapsed = time.perf_counter() - start
+
+    for sock in socks:
+        sock.close()
+
+    def percentiles(values):
+        values.sort()
+        return (values[int(len(values) * q)] * 1e6 for q in (0.5, 0.99))
+
+    p50, p99 = percentiles(delivery)
+    last50, last99 = percentiles(last_delivery)
+    print(f"{args.subscribers} subscribers, {args.messages} messages, "
+          f"{len(delivery) / elapsed:.0f} deliveries/s")
+    print(f"delivery       p50 {p50:9.1f} us  p99 {p99:9.1f} us")
+    print(f"last receiver  p50 {last50:9.1f} us  p99 {last99:9.1f} us")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <coroutine>
+#include <chrono>
+#include <cstddef>
+#include <sys/types.h>
+
+class ThreadPool;
+
+// Awaitable-объекты для обработчиков-корутин.
+// Операции ввода-вывода сначала пробуются сразу; если fd не готов,
+// корутина приостанавливается и возобновляется реактором.
+
+struct ReadAwaitable {
+    int fd;
+    char* buffer;
+    size_t length;
+    ssize_t result = -1;
+    int error = 0;
+
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> handle);
+    ssize_t await_resume();
+};
+
+struct WriteAwaitable {
+    int fd;
+    const char* data;
+    size_t length;
+    ssize_t result = -1;
+    int error = 0;
+
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> handle);
+    ssize_t await_resume();
+};
+
+struct TimerAwaitable {
+    std::chrono::milliseconds duration;
+    int timer_fd = -1;
+
+    bool await_ready() const { return duration.count() <= 0; }
+    bool await_suspend(std::coroutine_handle<> handle);
+    void await_resume();
+};
+
+// Переносит продолжение корутины в пул рабочих потоков
+struct OffloadAwaitable {
+    ThreadPool& pool;
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() {}
+};
+
+ReadAwaitable async_read(int fd, char* buffer, size_t length);
+WriteAwaitable async_write(int fd, const char* data, size_t length);
+TimerAwaitable sleep_for(std::chrono::milliseconds duration);
+OffloadAwaitable offload(ThreadPool& pool);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "handler.hpp"
+
+// Сжатие ответов (Content-Encoding) по Accept-Encoding клиента
+
+enum class Encoding : uint8_t {
+    IDENTITY,
+    GZIP,
+    DEFLATE,
+    BROTLI
+};
+
+const char* encoding_name(Encoding encoding);
+
+// Кодировка для ответа: IDENTITY, если тело не стоит сжимать
+// (мало, уже сжато, не текстовый тип) или клиент не принимает сжатие
+Encoding choose_encoding(const Response& response, const std::string& accept_encoding);
+
+// Сжимает тело и выставляет Content-Encoding, ETag и Vary. Выполняется
+// в рабочем потоке: контексты zlib создаются один раз на поток
+void apply_encoding(Response& response, Encoding encoding);
+
+// 64-битный хеш содержимого со случайным ключом процесса, ключ кеша
+// сжатых вариантов
+uint64_t content_hash(const char* data, size_t length);
+
+// Кеш сжатых вариантов по (хеш тела, длина, кодировка) с вытеснением LRU.
+// Вариант попадает в кеш, когда то же тело встречается второй раз:
+// уникальные динамические ответы не вытесняют горячие. Запись хранит
+// и исходное тело: get отдаёт вариант, только если тела совпали побайтно.
+class CompressionCache {
+public:
+    void configure(size_t capacity_bytes);
+    bool enabled() const { return capacity_ > 0; }
+
+    std::shared_ptr<const std::string> get(uint64_t hash, const std::string& identity, Encoding encoding);
+    // false - тело встретилось впервые, вариант не сохранён
+    bool admit(uint64_t hash, size_t length, Encoding encoding);
+    void put(uint64_t hash, const std::string& identity, Encoding encoding,
+        std::shared_ptr<const std::string> body);
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr size_t SEEN_LIMIT = 65536;
+
+    struct Key {
+        uint64_t hash;
+        size_t length;
+        Encoding encoding;
+        bool operator==(const Key& other) const = default;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return key.hash ^ (static_cast<size_t>(key.encoding) << 1);
+        }
+    };
+    struct Entry {
+        Key key;
+        std::string identity;   // несжатое тело для сверки
+        std::shared_ptr<const std::string> body;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;   // начало - недавно использованные
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        std::unordered_set<uint64_t> seen;
+        size_t bytes = 0;
+    };
+
+    Shard& shard_for(uint64_t hash) { return shards_[hash % SHARD_COUNT]; }
+
+    size_t capacity_ = 0;
+    Shard shards_[SHARD_COUNT];
+};
+
+struct CompressionStats {
+    std::atomic<size_t> compressed{ 0 };
+    std::atomic<size_t> cache_hits{ 0 };
+    std::atomic<size_t> bytes_in{ 0 };
+    std::atomic<size_t> bytes_out{ 0 };
+};
+
+extern CompressionCache compression_cache;
+extern CompressionStats compression_stats;
+
+// SERVER_COMPRESSION, SERVER_COMPRESS_MIN_SIZE, SERVER_COMPRESS_CACHE,
+// SERVER_GZIP_LEVEL, SERVER_BROTLI_QUALITY
+void configure_compression_from_env();
+void log_compression_stats();
@@ -3,16 +3,27 @@
 #include <string>
 #include <map>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <ctime>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "file_body.hpp"
 
 enum class ConnectionState {
     READING_REQUEST,   
     PROCESSING,        
     WRITING_RESPONSE,  
     CLOSING,
-	KEEP_ALIVE_WAITING
+	KEEP_ALIVE_WAITING,
+	HTTP2,             // соединение обслуживает сессия HTTP/2
+	WEBSOCKET
 };
 
+class Http2Session;
+class WsSession;
+class TlsSession;
+
 
 struct Connection {
 	int fd;
@@ -32,12 +43,41 @@ struct Connection {
 	int keep_alive_timeout;
 	int max_requests;
 	int handled_request;
+	size_t shard;       // шард рабочего пула, обслуживающий соединение
+	uint64_t peer_key;  // ключ адреса клиента для ограничения частоты
+	uint64_t trace_id;  // 0 - текущий запрос не трассируется
+	uint64_t accepted_at;
+	uint64_t generation; // номер соединения; fd после закрытия переиспользуется
+	// Флаги реактора: запрос у рабочего потока (обработчик держит
+	// указатель на соединение) и отложенное до его ответа удаление
+	bool busy;
+	bool close_pending;
+	std::shared_ptr<Http2Session> h2;  // разделяется с обработчиками потоков
+	std::shared_ptr<WsSession> ws;     // разделяется с подписками WsHub
+	std::unique_ptr<TlsSession> tls;
+	// Тело ответа из файла: отправляется после write_buffer
+	std::shared_ptr<FileBody> body_file;
+	std::vector<BodySegment> body_segments;
+	size_t segment_index;
+	size_t segment_offset;
+	bool nodelay;       // TCP_NODELAY уже включён
 
 	Connection(int socket_fd);
+	~Connection();
+
+	// Ввод-вывод сокета: через TLS, если он включён, иначе recv/send
+	ssize_t read_some(char* buffer, size_t length);
+	ssize_t write_some(const char* data, size_t length);
+	ssize_t write_vector(const struct iovec* iov, int count);
+	// В TLS остались расшифрованные данные, о которых epoll не сообщит
+	bool has_buffered_input() const;
 
 	void add_to_read(const char* data, size_t length);
 	void set_response(const std::string& response);
+	void set_body(std::shared_ptr<FileBody> file, std::vector<BodySegment> segments);
 	ssize_t send_data();
+	// Диапазон файла в сокет: sendfile, при TLS без kTLS - pread и запись
+	ssize_t send_file(off_t file_offset, size_t length);
 	bool parse_headers();
 	bool response_complete() const;
 	void parse_connection_params();
@@ -48,6 +88,14 @@ struct Connection {
 	bool is_max_requests() const;
 	bool is_valid_state() const;
 	bool headers_receive() const;
+
+	// Простаивающее keep-alive соединение: ждёт следующий запрос, буферы пусты
+	bool is_idle() const;
+	// Освобождает память буферов и заголовков; при следующем чтении
+	// они выделяются заново
+	void release_buffers();
+	// Оценка занимаемой соединением памяти в байтах
+	size_t memory_usage() const;
 	
 
 };
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Открытый файл - тело ответа. Данные уходят в сокет через sendfile
+// прямо из page cache и не копируются в write_buffer.
+struct FileBody {
+    int fd;
+    off_t size;
+    time_t mtime;
+
+    FileBody(int file_fd, off_t file_size, time_t modified);
+    ~FileBody();
+    FileBody(const FileBody&) = delete;
+    FileBody& operator=(const FileBody&) = delete;
+};
+
+// Участок тела: байты в памяти (заголовки частей multipart)
+// или диапазон файла [offset, offset + length)
+struct BodySegment {
+    std::string data;
+    off_t offset = 0;
+    size_t length = 0;
+    bool from_file = false;
+
+    static BodySegment memory(std::string bytes);
+    static BodySegment file_range(off_t offset, size_t length);
+    size_t size() const { return from_file ? length : data.size(); }
+};
+
+// Открывает обычный файл; nullptr, если его нет или это не файл
+std::shared_ptr<FileBody> open_file_body(const std::string& path);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Пул памяти для кадров корутин.
+// Свободные блоки хранятся в thread_local списках по классам размеров,
+// поэтому suspend/resume обработчиков не обращается к malloc.
+// Блок помнит пул-владелец: кадр, созданный в рабочем потоке и
+// уничтоженный в реакторе, возвращается в список рабочего потока.
+class FramePool {
+public:
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr, size_t size);
+
+    // Сколько раз пул обратился к operator new; в установившемся
+    // режиме число не растёт
+    static uint64_t heap_allocations();
+
+    static constexpr size_t GRANULARITY = 128;
+    static constexpr size_t MAX_POOLED_SIZE = 4096;
+    static constexpr size_t MAX_CACHED_PER_CLASS = 256;
+};
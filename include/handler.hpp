@@ -0,0 +1,38 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "connection.hpp"
+#include "file_body.hpp"
+#include "task.hpp"
+
+// Поля запроса (method, path, headers, body) разбираются прямо в Connection
+using Request = Connection;
+
+struct Response {
+    int status = 200;
+    std::string content_type = "text/plain";
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    // Тело из файла: если задано, body не используется, а тело
+    // собирается из segments и отправляется через sendfile
+    std::shared_ptr<FileBody> file;
+    std::vector<BodySegment> segments;
+
+    size_t content_length() const;
+    // Строка статуса, заголовки и тело из памяти
+    std::string to_string() const;
+};
+
+const char* status_text(int status);
+
+// Прикладной обработчик: корутина, которая может ждать сокеты, таймеры
+// и пул потоков, не занимая рабочий поток на время ожидания
+using RequestHandler = std::function<task<Response>(Request&)>;
+
+extern RequestHandler request_handler;
+
+task<Response> default_handler(Request& request);
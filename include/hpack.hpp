@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// HPACK (RFC 7541) для HTTP/2
+
+struct HeaderField {
+    std::string name;
+    std::string value;
+};
+
+class HpackDecoder {
+public:
+    explicit HpackDecoder(size_t max_table_size = 4096);
+
+    enum class Status { OK, COMPRESSION_ERROR, TOO_LARGE };
+
+    // Декодирует блок заголовков целиком. TOO_LARGE - список больше
+    // max_list_size (имя + значение + 32 на поле, RFC 7541 4.1):
+    // ссылки на таблицу раздувают короткий блок во много раз
+    Status decode(const uint8_t* data, size_t length, std::vector<HeaderField>& headers,
+        size_t max_list_size = SIZE_MAX);
+
+private:
+    bool lookup(uint64_t index, HeaderField& field) const;
+    void add(const HeaderField& field);
+    void evict(size_t limit);
+
+    std::deque<HeaderField> dynamic_table_;
+    size_t table_size_ = 0;
+    size_t max_table_size_;
+    size_t settings_max_size_;
+};
+
+// Кодировщик ответов: только статическая таблица (без состояния,
+// потому безопасен при любом SETTINGS_HEADER_TABLE_SIZE клиента).
+// Имена и значения кодируются по Хаффману, если так короче.
+class HpackEncoder {
+public:
+    static void encode(const std::string& name, const std::string& value, std::string& out);
+    static void encode_status(int status, std::string& out);
+};
+
+bool huffman_decode(const uint8_t* data, size_t length, std::string& out);
+void huffman_encode(const std::string& input, std::string& out);
+size_t huffman_encoded_length(const std::string& input);
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "connection.hpp"
+#include "handler.hpp"
+#include "hpack.hpp"
+
+// Поток HTTP/2: запрос передаётся в рабочий пул как Request,
+// ответ ждёт отправки с учётом окон управления потоком
+struct Http2Stream {
+    uint32_t id;
+    Request request;
+    std::string header_block;   // HEADERS + CONTINUATION до END_HEADERS
+    bool end_stream = false;    // клиент закрыл свою сторону
+    bool dispatched = false;
+
+    // Тело ответа: участки в памяти и диапазоны файла. Файл читается
+    // кадрами DATA по мере окон и освобождения очереди сессии
+    int64_t send_window;
+    std::shared_ptr<FileBody> file;
+    std::vector<BodySegment> segments;
+    size_t segment_index = 0;
+    size_t segment_offset = 0;
+    bool response_started = false;
+
+    Http2Stream(uint32_t stream_id, int fd, int64_t initial_window);
+};
+
+// Сессия HTTP/2 (h2c) поверх одного TCP-соединения.
+// feed() вызывается из потока реактора, submit_response() - из рабочих
+// потоков; состояние защищено mutex_. Исходящие кадры копятся в очереди
+// и уходят одним sendmsg/writev в flush().
+class Http2Session {
+public:
+    static constexpr size_t PREFACE_LENGTH = 24;
+
+    // data совпадает с началом клиентского preface
+    static bool is_preface_prefix(const std::string& data);
+
+    explicit Http2Session(int fd);
+
+    // Разбор полученных байт; потоки с полным запросом добавляются в ready
+    void feed(const char* data, size_t length, std::vector<std::shared_ptr<Http2Stream>>& ready);
+
+    // h2c через Upgrade: параметры из HTTP2-Settings, запрос
+    // HTTP/1.1 становится потоком 1
+    bool start_upgrade(const std::string& settings_base64, const Connection& request);
+    std::shared_ptr<Http2Stream> take_upgrade_stream();
+
+    // false - сессия закрыта или поток сброшен, отправлять нечего
+    bool submit_response(uint32_t stream_id, const Response& response);
+    // Соединение удалено: потоки и очередь освобождаются, поздние
+    // ответы обработчиков отбрасываются
+    void close();
+
+    // 0 - очередь отправлена, 1 - сокет заполнен (EAGAIN), -1 - ошибка
+    int flush(Connection& conn);
+
+    bool closing();
+    size_t memory_usage();
+
+private:
+    void handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id,
+        const uint8_t* payload, size_t length, std::vector<std::shared_ptr<Http2Stream>>& ready);
+    void handle_headers(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length,
+        std::vector<std::shared_ptr<Http2Stream>>& ready);
+    void handle_continuation(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length,
+        std::vector<std::shared_ptr<Http2Stream>>& ready);
+    void handle_data(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length,
+        std::vector<std::shared_ptr<Http2Stream>>& ready);
+    bool apply_settings(const uint8_t* payload, size_t length);
+    bool append_header_block(Http2Stream& stream, const uint8_t* payload, size_t length);
+    void end_headers(Http2Stream& stream, std::vector<std::shared_ptr<Http2Stream>>& ready);
+    void request_ready(const std::shared_ptr<Http2Stream>& stream,
+        std::vector<std::shared_ptr<Http2Stream>>& ready);
+
+    void send_pending(Http2Stream& stream);
+    void send_all_pending();
+    void queue_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const char* payload, size_t length);
+    void queue_settings();
+    void reset_stream(uint32_t stream_id, uint32_t error_code);
+    void go_away(uint32_t error_code);
+    void handle_go_away(uint32_t last_stream_id, uint32_t error_code);
+
+    int fd_;
+    std::mutex mutex_;
+    std::string input_;
+    bool preface_received_ = false;
+    bool closing_ = false;
+    bool closed_ = false;
+    bool peer_going_away_ = false;
+    // Последний наш поток, который клиент обработает; своих потоков
+    // сервер не открывает (push выключен), значение справочное
+    uint32_t peer_last_stream_id_ = 0;
+
+    HpackDecoder decoder_;
+    std::unordered_map<uint32_t, std::shared_ptr<Http2Stream>> streams_;
+    std::shared_ptr<Http2Stream> upgrade_stream_;
+    uint32_t last_stream_id_ = 0;
+    uint32_t continuation_stream_ = 0;   // ожидается CONTINUATION для этого потока
+
+    int64_t connection_send_window_ = 65535;
+    int64_t peer_initial_window_ = 65535;
+    size_t peer_max_frame_size_ = 16384;
+
+    std::deque<std::string> output_;
+    size_t output_offset_ = 0;
+    size_t output_bytes_ = 0;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Слушающий сокет: TCP (IPv4/IPv6) или AF_UNIX, в том числе
+// абстрактное пространство имён Linux ("unix:@name").
+//
+// Формат адреса: "0.0.0.0:8080", ":8080", "[::1]:8443", "unix:/run/app.sock",
+// "unix:@app"; после '?' через '&' - параметры:
+//   backlog=N        длина очереди listen (по умолчанию 128)
+//   nodelay          TCP_NODELAY, наследуется принятыми сокетами
+//   defer_accept=S   TCP_DEFER_ACCEPT: accept только после прихода данных
+//   fastopen=N       TCP_FASTOPEN с очередью N
+//   tls              соединения через TLS (нужен SERVER_TLS_CERT)
+//   mode=0660        права на файл сокета AF_UNIX
+struct ListenerConfig {
+    std::string address;    // исходная строка для журнала
+    int family = 0;         // AF_INET, AF_INET6, AF_UNIX
+    std::string host;
+    int port = 0;
+    std::string path;       // путь AF_UNIX без '@'
+    bool abstract = false;
+
+    int backlog = 128;
+    bool nodelay = false;
+    int defer_accept = 0;
+    int fastopen = 0;
+    bool tls = false;
+    int mode = -1;
+};
+
+struct Listener {
+    int fd = -1;
+    ListenerConfig config;
+};
+
+// Список адресов через запятую; бросает std::runtime_error при ошибке разбора
+std::vector<ListenerConfig> parse_listeners(const std::string& spec);
+
+// Неблокирующий слушающий сокет; бросает std::runtime_error
+Listener open_listener(const ListenerConfig& config);
+void close_listener(Listener& listener);
+const Listener* find_listener(const std::vector<Listener>& listeners, int fd);
+
+// SERVER_LISTEN (по умолчанию "0.0.0.0:8080")
+std::vector<Listener> open_listeners_from_env();
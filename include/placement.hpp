@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+enum class ShardMode {
+    NONE,       // один общий пул
+    PER_CORE,   // шард из одного потока на каждое ядро
+    PER_NODE    // шард на каждый NUMA-узел
+};
+
+// Политика размещения потоков по ядрам и NUMA-узлам.
+// Читается из переменных окружения:
+//   SERVER_REACTOR_CPUS=0        - ядра для потока реактора
+//   SERVER_WORKER_CPUS=1-7       - ядра для рабочих потоков
+//   SERVER_SHARDING=core|node    - разбиение пула на шарды
+//   SERVER_MATCH_INCOMING_CPU=1  - выбирать шард по SO_INCOMING_CPU
+struct PlacementPolicy {
+    std::vector<int> reactor_cpus;
+    std::vector<int> worker_cpus;
+    ShardMode shard_mode = ShardMode::NONE;
+    bool match_incoming_cpu = false;
+
+    static PlacementPolicy from_env();
+};
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+std::vector<int> parse_cpu_list(const std::string& list);
+
+int cpu_to_node(int cpu);
+bool pin_current_thread(const std::vector<int>& cpus);
+bool prefer_local_node(int node);
+int current_cpu();
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "handler.hpp"
+
+// Запросы диапазонов байт (RFC 7233): Range, If-Range, ответы 206 и 416.
+// Диапазоны поддерживает ответ с заголовком "Accept-Ranges: bytes".
+
+struct ByteRange {
+    uint64_t first;
+    uint64_t last;      // включительно
+
+    uint64_t length() const { return last - first + 1; }
+};
+
+enum class RangeStatus {
+    IGNORED,            // заголовок не разобран или не "bytes=": ответ целиком
+    SATISFIABLE,
+    UNSATISFIABLE       // ни один диапазон не пересекает тело: 416
+};
+
+// Разбирает "bytes=0-99,200-,-500" для тела длины size. Диапазоны
+// упорядочиваются, пересекающиеся и близкие объединяются
+RangeStatus parse_range(const std::string& header, uint64_t size, std::vector<ByteRange>& ranges);
+
+// If-Range: сильный ETag или точное совпадение Last-Modified
+bool if_range_matches(const std::string& if_range, const Response& response);
+
+// Превращает ответ 200 на GET с Range в 206 (один диапазон или
+// multipart/byteranges) или 416. Тело из файла остаётся в файле:
+// меняются только участки, которые отправит sendfile
+void apply_range(const Request& request, Response& response);
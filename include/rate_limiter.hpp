@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+
+// Ограничитель частоты по ключу (адрес клиента, значение заголовка).
+// Token bucket в lock-free хеш-таблице фиксированного размера с ленивым
+// пополнением; ключи, не поместившиеся в таблицу, учитываются
+// приближённо в count-min sketch. Проверка - несколько атомарных операций,
+// без блокировок и выделений памяти.
+class RateLimiter {
+public:
+    // rate - токенов в секунду, burst - ёмкость корзины; rate <= 0 отключает лимит
+    void configure(double rate, double burst, size_t capacity = 65536);
+    bool enabled() const { return table_ != nullptr; }
+
+    bool allow(uint64_t key);
+
+private:
+    static constexpr size_t PROBE_LIMIT = 8;
+    static constexpr size_t SKETCH_DEPTH = 4;
+    static constexpr size_t SKETCH_WIDTH = 4096;
+    static constexpr int TOKEN_BITS = 24;
+    static constexpr uint64_t TOKEN_MASK = (1ULL << TOKEN_BITS) - 1;
+    static constexpr uint64_t TOKEN_ONE = 256;   // фиксированная точка 1/256
+
+    // state: [время последнего пополнения, мс : 40][токены : 24].
+    // Нулевое состояние означает полную корзину.
+    struct alignas(16) Bucket {
+        std::atomic<uint64_t> key{ 0 };
+        std::atomic<uint64_t> state{ 0 };
+    };
+
+    Bucket* find_bucket(uint64_t key, uint64_t now_ms);
+    bool take_token(Bucket& bucket, uint64_t now_ms);
+    bool sketch_allow(uint64_t key, uint64_t now_ms);
+    uint64_t now_ms() const;
+
+    std::unique_ptr<Bucket[]> table_;
+    size_t mask_ = 0;
+    double refill_per_ms_ = 0;   // в единицах TOKEN_ONE
+    uint64_t burst_ = 0;         // в единицах TOKEN_ONE
+    uint64_t full_refill_ms_ = 0;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> sketch_;
+    std::atomic<uint64_t> sketch_window_{ 0 };
+    uint32_t sketch_limit_ = 0;
+};
+
+// Ключ клиента по адресу из accept(): IPv4 целиком, IPv6 - префикс /64;
+// 0 - адрес неизвестен
+uint64_t peer_key(const struct sockaddr_storage& address);
+// Адреса клиентов Unix-сокета одинаково пусты: ключ - uid процесса
+// (SO_PEERCRED). pid не подходит - его меняет любой fork
+uint64_t unix_peer_key(int fd);
+uint64_t string_key(const std::string& value);
+
+// Разбор "rate[:burst]"; без burst ёмкость равна rate
+void parse_rate(const char* value, double& rate, double& burst);
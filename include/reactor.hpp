@@ -1,10 +1,14 @@
 #pragma once
 
 #include <cstdint>
+#include <coroutine>
 
+// generation отличает соединение от следующего владельца того же fd;
+// 0 - без проверки (служебные уведомления)
 struct ReactorNotification {
 	int fd;
 	uint32_t events;
+	uint64_t generation;
 };
 
 class Reactor {
@@ -12,11 +16,18 @@ public:
 	Reactor();
 	~Reactor();
 
-	void notify(int fd, uint32_t events);
+	void notify(int fd, uint32_t events, uint64_t generation = 0);
 	int get_notify_fd() const { return pipe_[0]; }
 	bool read_notification(ReactorNotification& notification);
+
+	// Ожидание готовности fd корутиной: handle будет возобновлён
+	// в потоке реактора из dispatch_io()
+	bool wait_io(int fd, uint32_t events, std::coroutine_handle<> handle);
+	int get_io_fd() const { return io_epoll_; }
+	void dispatch_io();
 private:
 	int pipe_[2];
 	//int pipe_read_;   // pipe[0] - чтение
 	//int pipe_write_;  // pipe[1] - запись
+	int io_epoll_;      // epoll для fd, которых ждут корутины
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+using SchedClock = std::chrono::steady_clock;
+
+// Классы планирования рабочего пула. Между классами процессорное время
+// делится пропорционально весам, внутри класса задачи упорядочены
+// по дедлайну (EDF); задачам без дедлайна для порядка назначается
+// срок по умолчанию, чтобы поток запросов с дедлайнами их не вытеснял.
+struct SchedulingClass {
+    const char* name;
+    unsigned weight;
+};
+
+constexpr size_t CLASS_CRITICAL = 0;   // health-check, доверенный X-Priority: high
+constexpr size_t CLASS_DEFAULT = 1;
+constexpr size_t CLASS_BULK = 2;       // X-Priority: low
+constexpr size_t SCHED_CLASS_COUNT = 3;
+
+extern const SchedulingClass SCHEDULING_CLASSES[SCHED_CLASS_COUNT];
+
+struct TaskOptions {
+    size_t sched_class = CLASS_DEFAULT;
+    SchedClock::time_point deadline = SchedClock::time_point::max();
+    // Вызывается вместо задачи, если дедлайн истёк до её запуска
+    std::function<void()> on_expired;
+};
+
+struct ClassStats {
+    uint64_t dequeued = 0;
+    uint64_t expired = 0;
+    uint64_t total_wait_us = 0;
+    uint64_t max_wait_us = 0;
+};
+
+// Класс и дедлайн по сырому запросу (строка запроса и заголовки),
+// до полного разбора в рабочем потоке:
+//   X-Priority: low - понижение; high - только с SERVER_TRUST_PRIORITY=1
+//   X-Request-Timeout / Request-Timeout: <мс> - дедлайн от момента получения,
+//   не больше SERVER_MAX_REQUEST_TIMEOUT
+TaskOptions classify_request(const std::string& raw_request);
+
+// Значение заголовка name (в нижнем регистре) из сырого запроса
+bool find_raw_header(const std::string& raw, const char* name, std::string& value);
+
+// SERVER_TRUST_PRIORITY, SERVER_MAX_REQUEST_TIMEOUT, SERVER_DEFAULT_DEADLINE,
+// SERVER_ROUTE_CLASSES
+void configure_scheduling_from_env();
+
+// Задача без дедлайна упорядочивается так, будто её срок - момент
+// постановки плюс этот запас; истекшей она от этого не считается
+SchedClock::duration default_task_budget();
+
+// Маршруты с префиксом prefix попадают в sched_class (из SERVER_ROUTE_CLASSES);
+// при нескольких совпадениях решает самый длинный префикс
+void add_route_class(const std::string& prefix, size_t sched_class);
@@ -3,25 +3,58 @@
 #include "connection.hpp"
 #include "connection_map.hpp"
 #include "reactor.hpp"
-#include "thread_pool.hpp"
+#include "worker_shards.hpp"
 #include <sys/epoll.h>
+#include <memory>
+#include <vector>
+
+// Память соединений по последнему обходу check_connections.
+// Соединения с запросом у рабочего потока только считаются
+struct MemoryStats {
+    size_t idle_connections = 0;
+    size_t idle_bytes = 0;
+    size_t active_connections = 0;
+    size_t active_bytes = 0;
+    size_t busy_connections = 0;
+};
 
 extern ConnectionMap active_connections;
-extern ThreadPool worker_pool;
+extern WorkerShards worker_pool;
 extern Reactor reactor;
+extern size_t max_connections;
+extern size_t memory_budget;
+extern MemoryStats memory_stats;
 
 
 Connection* create_connection(int fd, int epoll_fd);
 Connection* get_connection(int fd);
 void delete_connection(int fd, int epoll_fd);
 void check_connections(int epoll_fd);
+void log_memory_stats();
+void configure_limits_from_env();
+// "512", "64K", "256M", "2G"
+size_t parse_size(const char* value);
 void process_request(Connection* conn, int epoll_fd);
+void reject_expired(Connection* conn);
 
-void handle_new_connection(int server_fd, int epoll_fd);
+struct Listener;
+void handle_new_connection(const Listener& listener, int epoll_fd);
 void handle_read(Connection* conn, int epoll_fd);
 void handle_write(Connection* conn, int epoll_fd);
 void handle_connection_error(Connection* conn, int epoll_fd);
+bool continue_handshake(Connection* conn, int epoll_fd);
+
+struct Http2Stream;
+void start_http2(Connection* conn, int epoll_fd);
+void switch_to_http2(Connection* conn, int epoll_fd);
+void handle_http2_read(Connection* conn, int epoll_fd);
+void dispatch_streams(Connection* conn, std::vector<std::shared_ptr<Http2Stream>>& ready);
+void flush_http2(Connection* conn, int epoll_fd);
+
+void switch_to_websocket(Connection* conn, int epoll_fd);
+void handle_websocket_read(Connection* conn, int epoll_fd);
+void flush_websocket(Connection* conn, int epoll_fd);
+void flush_websockets(int epoll_fd);
 
 
 void set_nonblocking(int fd);
-void setup_server_socket(int& server_fd, int port);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <ctime>
+#include <string>
+#include "handler.hpp"
+
+// Раздача файлов из каталога: тело ответа - открытый файл, который
+// уходит в сокет через sendfile. Ответ объявляет "Accept-Ranges: bytes",
+// ETag и Last-Modified, поэтому к нему применимы Range и If-Range.
+
+// Запросы под префиксом - файлы из корня, остальные - default_handler
+task<Response> static_file_handler(Request& request);
+
+// Дата HTTP (IMF-fixdate): "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string http_date(time_t time);
+
+// SERVER_STATIC_ROOT включает раздачу, SERVER_STATIC_PREFIX (по умолчанию "/")
+void configure_static_files_from_env();
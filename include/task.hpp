@@ -0,0 +1,144 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "frame_pool.hpp"
+
+// Кадры всех корутин сервера выделяются из FramePool
+struct PooledPromise {
+    static void* operator new(size_t size) {
+        return FramePool::allocate(size);
+    }
+    static void operator delete(void* ptr, size_t size) {
+        FramePool::deallocate(ptr, size);
+    }
+};
+
+template<typename T>
+class task;
+
+namespace detail {
+
+struct TaskPromiseBase : PooledPromise {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    // По завершении передаём управление ожидающей корутине (symmetric transfer)
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> next = handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T take_result() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    task<void> get_return_object();
+
+    void return_void() {}
+
+    void take_result() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+}
+
+// Ленивая корутина: запускается при co_await и возобновляет
+// ожидающую сторону после завершения.
+template<typename T>
+class task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    task() = default;
+    explicit task(handle_type handle) : handle_(handle) {}
+    task(task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task() {
+        if (handle_) handle_.destroy();
+    }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            handle_type handle;
+
+            bool await_ready() noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().take_result(); }
+        };
+        return Awaiter{ handle_ };
+    }
+
+private:
+    handle_type handle_;
+};
+
+namespace detail {
+
+template<typename T>
+task<T> TaskPromise<T>::get_return_object() {
+    return task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline task<void> TaskPromise<void>::get_return_object() {
+    return task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+}
+
+// Корутина верхнего уровня: стартует сразу и освобождает кадр сама.
+// Исключения должны обрабатываться внутри тела.
+struct detached_task {
+    struct promise_type : PooledPromise {
+        detached_task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
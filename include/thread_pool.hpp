@@ -9,22 +9,57 @@
 #include <condition_variable>
 #include <atomic>
 #include <memory>
+#include "scheduler.hpp"
 
 class ThreadPool {
 public:
     using Task = std::function<void()>;
 
-    ThreadPool(size_t num_threads);
+    // cpus - ядра, к которым привязываются потоки (пусто - без привязки),
+    // numa_node - узел, на котором потоки выделяют память (-1 - любой)
+    ThreadPool(size_t num_threads, std::vector<int> cpus = {}, int numa_node = -1);
     ~ThreadPool();
 
     void enqueue(Task task);
+    void enqueue(Task task, TaskOptions options);
     void stop();
 
+    std::vector<ClassStats> class_stats();
+
+    // Вызывающий поток - рабочий поток какого-либо пула
+    static bool on_worker_thread();
+
 private:
+    struct QueuedTask {
+        Task task;
+        std::function<void()> on_expired;
+        SchedClock::time_point deadline;
+        // Ключ EDF: дедлайн или срок по умолчанию для задач без него
+        SchedClock::time_point due;
+        SchedClock::time_point enqueued;
+        uint64_t seq;
+    };
+
+    // Куча по (срок, порядок поступления) и виртуальное время класса
+    // для взвешенного разделения (stride scheduling)
+    struct ClassQueue {
+        std::vector<QueuedTask> heap;
+        uint64_t pass = 0;
+        ClassStats stats;
+    };
+
+    static bool later(const QueuedTask& a, const QueuedTask& b);
+
     void worker_thread();
+    size_t pick_class() const;
 
     std::vector<std::thread> workers;
-    std::queue<Task> tasks;
+    std::vector<ClassQueue> classes;
+    size_t pending_ = 0;
+    uint64_t seq_ = 0;
+    uint64_t virtual_time_ = 0;
+    std::vector<int> cpus_;
+    int numa_node_;
 
     std::mutex queue_mutex;
     std::condition_variable condition;
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <memory>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+struct ssl_st;
+
+// TLS поверх неблокирующего сокета (OpenSSL). Все вызовы - из потока
+// реактора. read/write ведут себя как recv/send: при нехватке данных
+// или места в сокете возвращают -1 с errno = EAGAIN.
+class TlsSession {
+public:
+    // nullptr, если TLS не настроен или SSL_new не удался
+    static std::unique_ptr<TlsSession> create(int fd);
+    ~TlsSession();
+
+    // 1 - рукопожатие завершено, 0 - ждать готовности сокета, -1 - ошибка
+    int handshake();
+    bool established() const { return established_; }
+    // Рукопожатию нужна готовность на запись (EPOLLOUT)
+    bool wants_write() const { return wants_write_; }
+
+    ssize_t read(char* buffer, size_t length);
+    ssize_t write(const char* data, size_t length);
+    // Мелкие фрагменты собираются в одну запись TLS
+    ssize_t writev(const struct iovec* iov, int count);
+
+    // Расшифрованные данные, ещё не прочитанные из SSL
+    size_t pending() const;
+    // Шифрование отправки в ядре (kTLS): send/sendmsg/sendfile по fd
+    bool ktls_send() const { return ktls_send_; }
+    void shutdown();
+
+private:
+    explicit TlsSession(ssl_st* ssl);
+    size_t record_limit();
+    ssize_t write_record(const char* data, size_t length);
+
+    ssl_st* ssl_;
+    bool established_ = false;
+    bool wants_write_ = false;
+    bool ktls_send_ = false;
+
+    // Динамический размер записей: пока соединение «холодное» (начало
+    // или после паузы), записи укладываются в один сегмент TCP и
+    // браузер может разбирать ответ, не дожидаясь всего окна
+    size_t warm_bytes_ = 0;
+    time_t last_write_ = 0;
+    size_t retry_length_ = 0;   // SSL_write после WANT_WRITE повторяется той же длиной
+};
+
+struct TlsStats {
+    size_t full_handshakes = 0;
+    size_t resumed_handshakes = 0;
+    size_t failed_handshakes = 0;
+    size_t ktls_connections = 0;
+};
+
+extern TlsStats tls_stats;
+
+// SERVER_TLS_CERT, SERVER_TLS_KEY, SERVER_TLS_SESSION_CACHE, SERVER_TLS_TICKETS.
+// Возвращает true, если TLS включён
+bool configure_tls_from_env();
+bool tls_enabled();
+void log_tls_stats();
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct Connection;
+
+// Выборочная трассировка фаз запроса. Отмеченные запросы пишут события
+// в кольцевой буфер своего потока без блокировок; для остальных запись -
+// одна проверка trace_id == 0. Дамп - JSON для chrome://tracing и Perfetto.
+
+enum class TracePhase : uint8_t {
+    ACCEPT,
+    FIRST_BYTE,
+    HEADERS_COMPLETE,
+    ENQUEUE,
+    DEQUEUE,
+    HANDLER_START,
+    HANDLER_END,
+    NOTIFY,
+    EPOLLOUT_ARMED,
+    LAST_BYTE
+};
+
+const char* trace_phase_name(TracePhase phase);
+
+// Время accept запоминается, только если трассировка включена
+void trace_accept(Connection* conn);
+// Первый байт очередного запроса: решение о выборке. conn->trace_id
+// становится ненулевым, если запрос трассируется; для первого запроса
+// соединения в трассу попадает и accept
+void trace_start(Connection* conn);
+
+void trace_record(uint64_t trace_id, TracePhase phase, uint64_t timestamp = 0);
+
+inline void trace_event(uint64_t trace_id, TracePhase phase) {
+    if (trace_id != 0) {
+        trace_record(trace_id, phase);
+    }
+}
+
+// Имя потока в дампе ("reactor", "worker"); до первого события потока
+void trace_thread_name(const char* name);
+
+// Накопленные события в формате Chrome trace event
+std::string trace_json();
+
+// Запрос, обслуживаемый самим сервером (SERVER_TRACE_PATH)
+bool is_trace_request(const std::string& path);
+
+// Дамп по SIGUSR2: сигнал только ставит флаг, файл пишет реактор
+bool trace_dump_pending();
+void dump_trace_to_file();
+
+// SERVER_TRACE_SAMPLE (1 из N запросов), SERVER_TRACE_PATH, SERVER_TRACE_FILE
+void configure_tracing_from_env();
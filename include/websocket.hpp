@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Connection;
+
+// WebSocket (RFC 6455)
+
+enum WsOpcode : uint8_t {
+    WS_CONTINUATION = 0x0,
+    WS_TEXT = 0x1,
+    WS_BINARY = 0x2,
+    WS_CLOSE = 0x8,
+    WS_PING = 0x9,
+    WS_PONG = 0xa
+};
+
+struct WsMessage {
+    std::string data;
+    bool binary = false;
+};
+
+// Кадр кодируется один раз и разделяется между всеми получателями
+using WsFrame = std::shared_ptr<const std::string>;
+
+std::string websocket_accept_key(const std::string& client_key);
+WsFrame websocket_frame(WsOpcode opcode, const char* payload, size_t length);
+// XOR с маской клиента; offset - позиция data внутри полезной нагрузки
+void websocket_mask(char* data, size_t length, const uint8_t mask[4], size_t offset = 0);
+
+// Состояние WebSocket-соединения. feed() вызывается из потока реактора,
+// enqueue() - из любого потока (рассылка), поэтому очередь под mutex_.
+class WsSession {
+public:
+    static constexpr size_t MAX_MESSAGE_SIZE = 1 << 20;
+    static constexpr size_t MAX_QUEUED_BYTES = 4 << 20;
+
+    explicit WsSession(std::string topic);
+
+    void feed(const char* data, size_t length, std::vector<WsMessage>& messages);
+
+    // false - очередь медленного клиента переполнена, соединение закрывается
+    bool enqueue(const WsFrame& frame);
+    void close(uint16_t code);
+
+    // 0 - очередь отправлена, 1 - EAGAIN, -1 - ошибка
+    int flush(Connection& conn);
+
+    // Ping по таймеру соединения; false - pong не пришёл вовремя
+    bool check_alive(time_t now, int ping_interval, int pong_timeout);
+
+    bool closing();
+    bool overflowed();
+    const std::string& topic() const { return topic_; }
+    size_t memory_usage();
+
+private:
+    void handle_frame(uint8_t opcode, bool fin, char* payload, size_t length,
+        std::vector<WsMessage>& messages);
+    void queue_locked(const WsFrame& frame);
+    void close_locked(uint16_t code);
+
+    std::string topic_;
+    std::mutex mutex_;
+    std::string input_;
+    std::string message_;
+    uint8_t message_opcode_ = 0;
+    bool in_message_ = false;
+
+    std::deque<WsFrame> queue_;
+    size_t queue_offset_ = 0;
+    size_t queued_bytes_ = 0;
+    bool overflowed_ = false;
+    bool closing_ = false;
+
+    time_t last_seen_;
+    time_t ping_sent_ = 0;
+};
+
+// Подписки на темы и рассылка. Получатели с непустой очередью попадают
+// в список dirty, реактор отправляет их одним проходом после одного
+// уведомления через pipe, а не по уведомлению на каждого подписчика.
+class WsHub {
+public:
+    // Уведомление реактору: «есть очереди к отправке»
+    static constexpr int FLUSH_FD = -1;
+
+    void subscribe(const std::string& topic, int fd, std::shared_ptr<WsSession> session);
+    void unsubscribe_all(int fd);
+    size_t broadcast(const std::string& topic, const std::string& payload, bool binary = false);
+    size_t broadcast(const std::string& topic, const WsFrame& frame);
+    void mark_dirty(int fd);
+    std::vector<int> take_dirty();
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::unordered_map<int, std::shared_ptr<WsSession>>> topics_;
+    std::unordered_map<int, std::vector<std::string>> subscriptions_;
+
+    std::mutex dirty_mutex_;
+    std::vector<int> dirty_;
+};
+
+extern WsHub websocket_hub;
+
+// Обработчик входящих сообщений; вызывается в потоке реактора,
+// тяжёлую работу следует переносить в рабочий пул
+using WebSocketHandler = std::function<void(Connection&, WsMessage&)>;
+
+extern WebSocketHandler websocket_handler;
+
+// По умолчанию сообщение возвращается отправителю (эхо); при
+// SERVER_WS_BROADCAST=1 - рассылается всем подписчикам темы соединения
+void default_websocket_handler(Connection& conn, WsMessage& message);
+
+// SERVER_WS_BROADCAST
+void configure_websocket_from_env();
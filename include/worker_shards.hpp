@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "placement.hpp"
+#include "thread_pool.hpp"
+
+// Пул рабочих потоков, разбитый на шарды по ядрам или NUMA-узлам.
+// Задачи соединения всегда идут в один шард, локальный для того ядра,
+// на котором ядро ОС обработало его входящий трафик.
+class WorkerShards {
+public:
+    void start(const PlacementPolicy& policy);
+    void stop();
+
+    // Выбор шарда для нового соединения
+    size_t assign(int fd, int incoming_cpu) const;
+    ThreadPool& shard(size_t index) { return *shards_[index]; }
+    size_t size() const { return shards_.size(); }
+    bool match_incoming_cpu() const { return match_incoming_cpu_; }
+
+    // Время ожидания в очереди по классам планирования, суммарно по шардам
+    std::vector<ClassStats> class_stats();
+    void log_stats();
+
+private:
+    static constexpr size_t NO_SHARD = static_cast<size_t>(-1);
+
+    std::vector<std::unique_ptr<ThreadPool>> shards_;
+    std::vector<size_t> cpu_shard_;   // cpu -> шард
+    std::vector<int> shard_node_;     // шард -> NUMA-узел
+    std::vector<int> cpu_node_;       // cpu -> NUMA-узел
+    ShardMode mode_ = ShardMode::NONE;
+    bool match_incoming_cpu_ = false;
+};
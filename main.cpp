@@ -1,27 +1,63 @@
 ﻿#include "server.hpp"
 #include "connection.hpp"
+#include "websocket.hpp"
+#include "tls.hpp"
+#include "compression.hpp"
+#include "trace.hpp"
+#include "listener.hpp"
+#include "static_files.hpp"
+#include "scheduler.hpp"
 #include <sys/epoll.h>
 #include <iostream>
 #include <cstring>
 #include <csignal>
 #include <memory>
 #include <ctime>
+#include <vector>
 
 const int MAX_EVENTS = 1024;
-const int PORT = 8080;
 time_t last_check = 0;
 const int CHECK_INTERVAL = 1;
+time_t last_stats = 0;
+const int STATS_INTERVAL = 10;
 
-volatile bool running = true;
+volatile std::sig_atomic_t running = 1;
+
+// SIGINT/SIGTERM: выход из цикла и закрытие слушателей (файлы AF_UNIX удаляются)
+void stop_server(int) {
+    running = 0;
+}
 
 
 int main() {
 
-    int server_fd = -1;
+    std::vector<Listener> listeners;
     int epoll_fd = -1;
 
     try {
-        setup_server_socket(server_fd, PORT);
+        std::signal(SIGINT, stop_server);
+        std::signal(SIGTERM, stop_server);
+
+        configure_limits_from_env();
+        configure_tls_from_env();
+        configure_compression_from_env();
+        configure_tracing_from_env();
+        configure_static_files_from_env();
+        configure_websocket_from_env();
+        configure_scheduling_from_env();
+        trace_thread_name("reactor");
+
+        // Потоки наследуют привязку и политику памяти создателя: пул
+        // запускается до закрепления реактора, иначе рабочие без своего
+        // списка CPU окажутся на ядрах и узле реактора
+        PlacementPolicy placement = PlacementPolicy::from_env();
+        worker_pool.start(placement);
+        pin_current_thread(placement.reactor_cpus);
+        if (!placement.reactor_cpus.empty()) {
+            prefer_local_node(cpu_to_node(placement.reactor_cpus.front()));
+        }
+
+        listeners = open_listeners_from_env();
 
         epoll_fd = epoll_create1(0);
         if (epoll_fd == -1) {
@@ -29,10 +65,12 @@ int main() {
         }
 
         struct epoll_event event {};
-        event.events = EPOLLIN | EPOLLET;
-        event.data.fd = server_fd;
-        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &event) == -1) {
-            throw std::runtime_error("epoll_ctl failed: " + std::string(strerror(errno)));
+        for (const Listener& listener : listeners) {
+            event.events = EPOLLIN | EPOLLET;
+            event.data.fd = listener.fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener.fd, &event) == -1) {
+                throw std::runtime_error("epoll_ctl failed: " + std::string(strerror(errno)));
+            }
         }
 
         int notify_fd = reactor.get_notify_fd();
@@ -42,8 +80,16 @@ int main() {
             throw std::runtime_error("epoll_ctl notify failed: " + std::string(strerror(errno)));
         }
 
-        std::cout << "[INFO] Сервер готов на порту " << PORT << std::endl;
-        std::cout << "[INFO] Рабочих потоков: " << std::thread::hardware_concurrency() << std::endl;
+        int io_fd = reactor.get_io_fd();
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = io_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, io_fd, &event) == -1) {
+            throw std::runtime_error("epoll_ctl io failed: " + std::string(strerror(errno)));
+        }
+
+        std::cout << "[INFO] Сервер готов, слушателей: " << listeners.size() << std::endl;
+        std::cout << "[INFO] Рабочих потоков: " << (placement.worker_cpus.empty()
+            ? std::thread::hardware_concurrency() : placement.worker_cpus.size()) << std::endl;
 
         struct epoll_event events[MAX_EVENTS];
 
@@ -54,10 +100,23 @@ int main() {
                 check_connections(epoll_fd);
                 last_check = now;
             }
+            if (now - last_stats >= STATS_INTERVAL) {
+                worker_pool.log_stats();
+                log_memory_stats();
+                log_tls_stats();
+                log_compression_stats();
+                last_stats = now;
+            }
+            if (trace_dump_pending()) {
+                dump_trace_to_file();
+            }
             int n = epoll_wait(epoll_fd, events, MAX_EVENTS, 10);
 
             if (n == -1) {
-                
+                // Прерван сигналом (SIGUSR2 - дамп трассы)
+                if (errno == EINTR) {
+                    continue;
+                }
                 std::cerr << "[ERROR] epoll_wait failed: " << strerror(errno) << std::endl;
                 break;
             }
@@ -67,18 +126,44 @@ int main() {
                 if (events[i].data.fd == notify_fd) {
                     ReactorNotification notification;
                     while (reactor.read_notification(notification)) {
+                        // Рассылка WebSocket: отправить все накопившиеся очереди
+                        if (notification.fd == WsHub::FLUSH_FD) {
+                            flush_websockets(epoll_fd);
+                            continue;
+                        }
                         Connection* conn = get_connection(notification.fd);
+                        // Соединение закрыто, fd уже у другого клиента
+                        if (conn && notification.generation != 0 && conn->generation != notification.generation) {
+                            continue;
+                        }
                         if (conn) {
+                            // Ответ готов: соединение снова принадлежит реактору
+                            conn->busy = false;
+                            if (conn->close_pending) {
+                                delete_connection(notification.fd, epoll_fd);
+                                continue;
+                            }
                             // epoll на запись
                             struct epoll_event ev {};
                             ev.events = EPOLLOUT | EPOLLRDHUP ;
+                            // Сессия HTTP/2 продолжает читать, пока отправляет ответы
+                            if (conn->state == ConnectionState::HTTP2 ||
+                                conn->state == ConnectionState::WEBSOCKET) {
+                                ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                            }
                             ev.data.ptr = conn;
                             epoll_ctl(epoll_fd, EPOLL_CTL_MOD, notification.fd, &ev);
+                            trace_event(conn->trace_id, TracePhase::EPOLLOUT_ARMED);
                         }
                     }
                 }
-                else if (events[i].data.fd == server_fd) {
-                    handle_new_connection(server_fd, epoll_fd);
+                // Готовность fd, которых ждут обработчики-корутины
+                else if (events[i].data.fd == io_fd) {
+                    reactor.dispatch_io();
+                }
+                // Новые подключения на одном из слушателей
+                else if (const Listener* listener = find_listener(listeners, events[i].data.fd)) {
+                    handle_new_connection(*listener, epoll_fd);
                 }
                 // Обработка клиентских событий
                 else {
@@ -94,12 +179,13 @@ int main() {
                     }
 
                     // Можно читать
+                    int fd = conn->fd;
                     if (events[i].events & EPOLLIN) {
                         handle_read(conn, epoll_fd);
                     }
 
-                    // Можно писать
-                    if (events[i].events & EPOLLOUT) {
+                    // Можно писать (если чтение не закрыло соединение)
+                    if ((events[i].events & EPOLLOUT) && get_connection(fd) == conn) {
                         handle_write(conn, epoll_fd);
                     }
                 }
@@ -119,12 +205,13 @@ int main() {
         close(epoll_fd);
     }
 
-    if (server_fd != -1) {
-        close(server_fd);
+    for (Listener& listener : listeners) {
+        close_listener(listener);
     }
 
-    active_connections.clear();
+    // Рабочие потоки завершают задачи до удаления соединений
     worker_pool.stop();
+    active_connections.clear();
 
     std::cout << "[INFO] Сервер остановлен." << std::endl;
     return 0;
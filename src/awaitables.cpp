@@ -0,0 +1,109 @@
+#include "awaitables.hpp"
+#include "server.hpp"
+#include <unistd.h>
+#include <cerrno>
+#include <sys/timerfd.h>
+
+namespace {
+
+bool would_block(int err) {
+    return err == EAGAIN || err == EWOULDBLOCK;
+}
+
+}
+
+bool ReadAwaitable::await_ready() {
+    result = read(fd, buffer, length);
+    error = result == -1 ? errno : 0;
+    return !(result == -1 && would_block(error));
+}
+
+bool ReadAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    if (!reactor.wait_io(fd, EPOLLIN | EPOLLRDHUP, handle)) {
+        error = errno;
+        return false;
+    }
+    return true;
+}
+
+ssize_t ReadAwaitable::await_resume() {
+    if (result == -1 && would_block(error)) {
+        result = read(fd, buffer, length);
+        error = result == -1 ? errno : 0;
+    }
+    errno = error;
+    return result;
+}
+
+bool WriteAwaitable::await_ready() {
+    result = write(fd, data, length);
+    error = result == -1 ? errno : 0;
+    return !(result == -1 && would_block(error));
+}
+
+bool WriteAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    if (!reactor.wait_io(fd, EPOLLOUT, handle)) {
+        error = errno;
+        return false;
+    }
+    return true;
+}
+
+ssize_t WriteAwaitable::await_resume() {
+    if (result == -1 && would_block(error)) {
+        result = write(fd, data, length);
+        error = result == -1 ? errno : 0;
+    }
+    errno = error;
+    return result;
+}
+
+bool TimerAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd == -1) {
+        return false;
+    }
+
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(duration - seconds);
+    struct itimerspec spec {};
+    spec.it_value.tv_sec = seconds.count();
+    spec.it_value.tv_nsec = nanos.count();
+
+    if (timerfd_settime(timer_fd, 0, &spec, nullptr) == -1 ||
+        !reactor.wait_io(timer_fd, EPOLLIN, handle)) {
+        close(timer_fd);
+        timer_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void TimerAwaitable::await_resume() {
+    if (timer_fd != -1) {
+        close(timer_fd);
+        timer_fd = -1;
+    }
+}
+
+void OffloadAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    pool.enqueue([handle]() {
+        handle.resume();
+        });
+}
+
+ReadAwaitable async_read(int fd, char* buffer, size_t length) {
+    return ReadAwaitable{ fd, buffer, length };
+}
+
+WriteAwaitable async_write(int fd, const char* data, size_t length) {
+    return WriteAwaitable{ fd, data, length };
+}
+
+TimerAwaitable sleep_for(std::chrono::milliseconds duration) {
+    return TimerAwaitable{ duration };
+}
+
+OffloadAwaitable offload(ThreadPool& pool) {
+    return OffloadAwaitable{ pool };
+}
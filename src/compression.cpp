@@ -0,0 +1,453 @@
+#include "compression.hpp"
+#include "server.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <strings.h>
+
+#ifdef SERVER_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SERVER_WITH_BROTLI
+#include <brotli/encode.h>
+#endif
+
+CompressionCache compression_cache;
+CompressionStats compression_stats;
+
+namespace {
+
+#ifdef SERVER_WITH_ZLIB
+bool compression_enabled = true;
+#else
+bool compression_enabled = false;
+#endif
+size_t min_size = 1024;            // меньше - заголовки сжатия съедают выигрыш
+int gzip_level = 6;
+int brotli_quality = 5;            // 11 слишком медленно для динамических ответов
+
+bool available(Encoding encoding) {
+    switch (encoding) {
+#ifdef SERVER_WITH_ZLIB
+    case Encoding::GZIP:
+    case Encoding::DEFLATE:
+        return true;
+#endif
+#ifdef SERVER_WITH_BROTLI
+    case Encoding::BROTLI:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+std::string lowercase(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    return value;
+}
+
+std::string trim(const std::string& value) {
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+std::vector<std::pair<std::string, std::string>>::iterator find_header(Response& response, const char* name) {
+    return std::find_if(response.headers.begin(), response.headers.end(),
+        [name](const auto& header) { return strcasecmp(header.first.c_str(), name) == 0; });
+}
+
+bool has_header(const Response& response, const char* name) {
+    return std::any_of(response.headers.begin(), response.headers.end(),
+        [name](const auto& header) { return strcasecmp(header.first.c_str(), name) == 0; });
+}
+
+// Текстовые форматы; изображения, архивы и видео уже сжаты
+bool compressible_type(const std::string& content_type) {
+    std::string type = lowercase(trim(content_type.substr(0, content_type.find(';'))));
+    if (type.compare(0, 5, "text/") == 0) {
+        return true;
+    }
+    static const char* const TYPES[] = {
+        "application/json", "application/javascript", "application/xml",
+        "application/xhtml+xml", "application/wasm", "image/svg+xml",
+    };
+    for (const char* known : TYPES) {
+        if (type == known) return true;
+    }
+    size_t plus = type.rfind('+');
+    return plus != std::string::npos && (type.compare(plus, 5, "+json") == 0 || type.compare(plus, 4, "+xml") == 0);
+}
+
+bool compressible(const Response& response) {
+    if (!compression_enabled || response.body.size() < min_size) {
+        return false;
+    }
+    // 206 - диапазон байт конкретного представления
+    if (response.status == 206 || response.status == 204 || response.status == 304) {
+        return false;
+    }
+    return !has_header(response, "content-encoding") && compressible_type(response.content_type);
+}
+
+// Кодировка с наибольшим q; при равенстве br > gzip > deflate
+Encoding negotiate(const std::string& accept_encoding) {
+    double quality[4] = { -1, -1, -1, -1 };
+    double wildcard = -1;
+
+    size_t pos = 0;
+    while (pos < accept_encoding.size()) {
+        size_t end = accept_encoding.find(',', pos);
+        if (end == std::string::npos) {
+            end = accept_encoding.size();
+        }
+        std::string token = accept_encoding.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t semicolon = token.find(';');
+        std::string name = lowercase(trim(token.substr(0, semicolon)));
+        double q = 1.0;
+        if (semicolon != std::string::npos) {
+            std::string params = lowercase(token.substr(semicolon));
+            size_t q_pos = params.find("q=");
+            if (q_pos != std::string::npos) {
+                q = std::strtod(params.c_str() + q_pos + 2, nullptr);
+            }
+        }
+
+        if (name == "gzip" || name == "x-gzip") quality[static_cast<int>(Encoding::GZIP)] = q;
+        else if (name == "deflate") quality[static_cast<int>(Encoding::DEFLATE)] = q;
+        else if (name == "br") quality[static_cast<int>(Encoding::BROTLI)] = q;
+        else if (name == "*") wildcard = q;
+    }
+
+    Encoding best = Encoding::IDENTITY;
+    double best_quality = 0;
+    for (Encoding encoding : { Encoding::BROTLI, Encoding::GZIP, Encoding::DEFLATE }) {
+        if (!available(encoding)) continue;
+        double q = quality[static_cast<int>(encoding)];
+        if (q < 0) q = wildcard;
+        if (q > best_quality) {
+            best = encoding;
+            best_quality = q;
+        }
+    }
+    return best;
+}
+
+#ifdef SERVER_WITH_ZLIB
+// Контекст deflate живёт всё время жизни рабочего потока;
+// deflateReset дешевле, чем deflateInit2 с выделением окна на каждый ответ
+struct DeflateContext {
+    z_stream stream {};
+    bool ready = false;
+
+    explicit DeflateContext(int window_bits) {
+        ready = deflateInit2(&stream, gzip_level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~DeflateContext() {
+        if (ready) deflateEnd(&stream);
+    }
+};
+
+bool deflate_body(Encoding encoding, const std::string& input, std::string& output) {
+    // gzip - обёртка gzip (windowBits + 16), deflate - формат zlib (RFC 9110)
+    thread_local DeflateContext gzip_context(MAX_WBITS + 16);
+    thread_local DeflateContext zlib_context(MAX_WBITS);
+    DeflateContext& context = encoding == Encoding::GZIP ? gzip_context : zlib_context;
+    if (!context.ready || input.size() > UINT_MAX) {
+        return false;
+    }
+
+    z_stream& stream = context.stream;
+    deflateReset(&stream);
+    output.resize(deflateBound(&stream, input.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        return false;
+    }
+    output.resize(stream.total_out);
+    return true;
+}
+#endif
+
+#ifdef SERVER_WITH_BROTLI
+// Состояние кодера Brotli нельзя переиспользовать после завершения
+// потока, поэтому сжатие однократное
+bool brotli_body(const std::string& input, std::string& output) {
+    size_t size = BrotliEncoderMaxCompressedSize(input.size());
+    if (size == 0) {
+        return false;
+    }
+    output.resize(size);
+    if (!BrotliEncoderCompress(brotli_quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, input.size(),
+        reinterpret_cast<const uint8_t*>(input.data()), &size, reinterpret_cast<uint8_t*>(output.data()))) {
+        return false;
+    }
+    output.resize(size);
+    return true;
+}
+#endif
+
+bool encode_body(Encoding encoding, const std::string& input, std::string& output) {
+    switch (encoding) {
+#ifdef SERVER_WITH_ZLIB
+    case Encoding::GZIP:
+    case Encoding::DEFLATE:
+        return deflate_body(encoding, input, output);
+#endif
+#ifdef SERVER_WITH_BROTLI
+    case Encoding::BROTLI:
+        return brotli_body(input, output);
+#endif
+    default:
+        return false;
+    }
+}
+
+// Представление зависит от Accept-Encoding - кешам нужен Vary
+void add_vary(Response& response) {
+    auto vary = find_header(response, "vary");
+    if (vary == response.headers.end()) {
+        response.headers.emplace_back("Vary", "Accept-Encoding");
+        return;
+    }
+    std::string value = lowercase(vary->second);
+    if (trim(value) != "*" && value.find("accept-encoding") == std::string::npos) {
+        vary->second += ", Accept-Encoding";
+    }
+}
+
+// Сильный ETag сжатого варианта отличается от ETag исходного тела
+void tag_variant(Response& response, Encoding encoding) {
+    auto etag = find_header(response, "etag");
+    if (etag == response.headers.end()) {
+        return;
+    }
+    std::string& value = etag->second;
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        value.insert(value.size() - 1, std::string("-") + encoding_name(encoding));
+    }
+}
+
+bool cacheable(Response& response) {
+    auto cache_control = find_header(response, "cache-control");
+    if (cache_control == response.headers.end()) {
+        return true;
+    }
+    std::string value = lowercase(cache_control->second);
+    return value.find("no-store") == std::string::npos && value.find("private") == std::string::npos;
+}
+
+inline uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline uint64_t rotl(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+// Случайный ключ хеша на процесс: клиент не может заранее подобрать
+// тела с одинаковым хешем
+uint64_t random_key() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
+
+const uint64_t HASH_KEY = random_key();
+
+}
+
+const char* encoding_name(Encoding encoding) {
+    switch (encoding) {
+    case Encoding::GZIP: return "gzip";
+    case Encoding::DEFLATE: return "deflate";
+    case Encoding::BROTLI: return "br";
+    default: return "identity";
+    }
+}
+
+uint64_t content_hash(const char* data, size_t length) {
+    const uint64_t K = 0x9e3779b97f4a7c15ULL;
+
+    // Четыре независимые полосы: умножения идут параллельно
+    uint64_t lanes[4] = { K ^ HASH_KEY, (K * 3) ^ HASH_KEY, (K * 5) ^ HASH_KEY, (K * 7) ^ HASH_KEY };
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t value;
+            std::memcpy(&value, data + i + lane * 8, 8);
+            lanes[lane] = rotl((lanes[lane] ^ value) * K, 29);
+        }
+    }
+
+    uint64_t hash = mix(length ^ K ^ HASH_KEY);
+    for (uint64_t lane : lanes) {
+        hash = (hash ^ mix(lane)) * K;
+    }
+    for (; i + 8 <= length; i += 8) {
+        uint64_t value;
+        std::memcpy(&value, data + i, 8);
+        hash = (hash ^ mix(value)) * K;
+    }
+    if (i < length) {
+        uint64_t value = 0;
+        std::memcpy(&value, data + i, length - i);
+        hash = (hash ^ mix(value ^ (length - i))) * K;
+    }
+    return mix(hash);
+}
+
+Encoding choose_encoding(const Response& response, const std::string& accept_encoding) {
+    if (accept_encoding.empty() || !compressible(response)) {
+        return Encoding::IDENTITY;
+    }
+    return negotiate(accept_encoding);
+}
+
+void apply_encoding(Response& response, Encoding encoding) {
+    if (!compressible(response)) {
+        return;
+    }
+    add_vary(response);
+    if (encoding == Encoding::IDENTITY) {
+        return;
+    }
+
+    size_t length = response.body.size();
+    bool use_cache = compression_cache.enabled() && cacheable(response);
+    uint64_t hash = use_cache ? content_hash(response.body.data(), length) : 0;
+
+    std::string encoded;
+    if (auto cached = use_cache ? compression_cache.get(hash, response.body, encoding) : nullptr) {
+        encoded = *cached;
+        compression_stats.cache_hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        // Сжатие, которое не уменьшило тело, не применяется
+        if (!encode_body(encoding, response.body, encoded) || encoded.size() >= length) {
+            return;
+        }
+        compression_stats.compressed.fetch_add(1, std::memory_order_relaxed);
+        if (use_cache && compression_cache.admit(hash, length, encoding)) {
+            compression_cache.put(hash, response.body, encoding, std::make_shared<const std::string>(encoded));
+        }
+    }
+
+    compression_stats.bytes_in.fetch_add(length, std::memory_order_relaxed);
+    compression_stats.bytes_out.fetch_add(encoded.size(), std::memory_order_relaxed);
+    response.body.swap(encoded);
+    response.headers.emplace_back("Content-Encoding", encoding_name(encoding));
+    tag_variant(response, encoding);
+}
+
+void CompressionCache::configure(size_t capacity_bytes) {
+    capacity_ = capacity_bytes;
+}
+
+std::shared_ptr<const std::string> CompressionCache::get(uint64_t hash, const std::string& identity,
+    Encoding encoding) {
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(Key{ hash, identity.size(), encoding });
+    if (it == shard.index.end()) {
+        return nullptr;
+    }
+    // Совпал только хеш: вариант другого тела не отдаётся
+    if (it->second->identity != identity) {
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->body;
+}
+
+bool CompressionCache::admit(uint64_t hash, size_t length, Encoding encoding) {
+    Shard& shard = shard_for(hash);
+    uint64_t key = hash ^ length ^ static_cast<uint64_t>(encoding);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.seen.count(key)) {
+        return true;
+    }
+    if (shard.seen.size() >= SEEN_LIMIT / SHARD_COUNT) {
+        shard.seen.clear();
+    }
+    shard.seen.insert(key);
+    return false;
+}
+
+void CompressionCache::put(uint64_t hash, const std::string& identity, Encoding encoding,
+    std::shared_ptr<const std::string> body) {
+    size_t shard_capacity = capacity_ / SHARD_COUNT;
+    size_t entry_size = identity.size() + body->size();
+    // Один вариант не должен вытеснять почти весь шард
+    if (entry_size > shard_capacity / 4) {
+        return;
+    }
+
+    Shard& shard = shard_for(hash);
+    Key key{ hash, identity.size(), encoding };
+    // Копия тела снимается до захвата мьютекса шарда
+    std::string stored = identity;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.index.count(key)) {
+        return;
+    }
+    shard.bytes += entry_size;
+    shard.lru.push_front(Entry{ key, std::move(stored), std::move(body) });
+    shard.index[key] = shard.lru.begin();
+
+    while (shard.bytes > shard_capacity && !shard.lru.empty()) {
+        Entry& oldest = shard.lru.back();
+        shard.bytes -= oldest.identity.size() + oldest.body->size();
+        shard.index.erase(oldest.key);
+        shard.lru.pop_back();
+    }
+}
+
+void configure_compression_from_env() {
+    if (const char* value = std::getenv("SERVER_COMPRESSION")) {
+        compression_enabled = compression_enabled && std::string(value) != "0";
+    }
+    if (const char* value = std::getenv("SERVER_COMPRESS_MIN_SIZE")) {
+        min_size = parse_size(value);
+    }
+    if (const char* value = std::getenv("SERVER_GZIP_LEVEL")) {
+        gzip_level = std::clamp(std::atoi(value), 1, 9);
+    }
+    if (const char* value = std::getenv("SERVER_BROTLI_QUALITY")) {
+        brotli_quality = std::clamp(std::atoi(value), 0, 11);
+    }
+
+    size_t cache_size = 16 << 20;
+    if (const char* value = std::getenv("SERVER_COMPRESS_CACHE")) {
+        cache_size = parse_size(value);
+    }
+    compression_cache.configure(compression_enabled ? cache_size : 0);
+}
+
+void log_compression_stats() {
+    if (!compression_enabled) {
+        return;
+    }
+    size_t bytes_in = compression_stats.bytes_in.load(std::memory_order_relaxed);
+    size_t bytes_out = compression_stats.bytes_out.load(std::memory_order_relaxed);
+    std::cout << "[COMPRESS] compressed=" << compression_stats.compressed.load(std::memory_order_relaxed)
+        << " cache_hits=" << compression_stats.cache_hits.load(std::memory_order_relaxed)
+        << " bytes_in=" << bytes_in
+        << " bytes_out=" << bytes_out << std::endl;
+}
@@ -1,9 +1,17 @@
 #include "connection.hpp"
+#include "http2.hpp"
+#include "websocket.hpp"
+#include "tls.hpp"
 #include <cstring>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <ctime>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
 
 Connection::Connection(int socket_fd) :
 	fd(socket_fd),
@@ -13,32 +21,163 @@ Connection::Connection(int socket_fd) :
 	keep_alive(true), // http 1.1
 	keep_alive_timeout(-1),
 	max_requests(10),
-	handled_request(0)
+	handled_request(0),
+	shard(0),
+	peer_key(0),
+	trace_id(0),
+	accepted_at(0),
+	generation(0),
+	busy(false),
+	close_pending(false),
+	segment_index(0),
+	segment_offset(0),
+	nodelay(false)
 {
 	update_activity();
 };
 
+Connection::~Connection() = default;
+
+ssize_t Connection::read_some(char* buffer, size_t length) {
+	if (tls) {
+		return tls->read(buffer, length);
+	}
+	return recv(fd, buffer, length, 0);
+}
+
+ssize_t Connection::write_some(const char* data, size_t length) {
+	if (tls) {
+		return tls->write(data, length);
+	}
+	return send(fd, data, length, MSG_NOSIGNAL);
+}
+
+ssize_t Connection::write_vector(const struct iovec* iov, int count) {
+	if (tls) {
+		return tls->writev(iov, count);
+	}
+	struct msghdr message {};
+	message.msg_iov = const_cast<struct iovec*>(iov);
+	message.msg_iovlen = count;
+	return sendmsg(fd, &message, MSG_NOSIGNAL);
+}
+
+bool Connection::has_buffered_input() const {
+	return tls && tls->pending() > 0;
+}
+
 void Connection::add_to_read(const char* data, size_t length) {
 	read_buffer.append(data, length);
 	update_activity();
 }
 
+namespace {
+
+// Доля одного вызова sendfile: соединение с большим файлом
+// не держит поток реактора до заполнения буфера сокета
+const size_t SENDFILE_CHUNK = 1 << 20;
+// Кусок файла для TLS без kTLS: шифрование идёт в пользовательском пространстве
+const size_t TLS_FILE_CHUNK = 16384;
+
+}
+
 void Connection::set_response(const std::string& response) {
 	write_buffer = response;
 	state = ConnectionState::WRITING_RESPONSE;
 	offset = 0;
+	body_file.reset();
+	body_segments.clear();
+	segment_index = 0;
+	segment_offset = 0;
 	update_activity();
 }
 
+void Connection::set_body(std::shared_ptr<FileBody> file, std::vector<BodySegment> segments) {
+	body_file = std::move(file);
+	body_segments = std::move(segments);
+	// Пустой участок дал бы send_data() == 0 до конца ответа
+	std::erase_if(body_segments, [](const BodySegment& segment) { return segment.size() == 0; });
+	segment_index = 0;
+	segment_offset = 0;
+
+	// Хвост sendfile меньше MSS иначе ждёт отложенного ACK клиента (~40 мс).
+	// Для сокета AF_UNIX вызов просто не удаётся
+	if (!nodelay) {
+		int enable = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+		nodelay = true;
+	}
+}
+
 ssize_t Connection::send_data() {
 	size_t remaining = write_buffer.size() - offset;;
-	if (remaining == 0) {
-		return 0;
+	if (remaining > 0) {
+		ssize_t sent;
+		// Заголовки ждут начала тела из файла в том же сегменте TCP
+		if (!tls && segment_index < body_segments.size()) {
+			sent = send(fd, write_buffer.data() + offset, remaining, MSG_NOSIGNAL | MSG_MORE);
+		}
+		else {
+			sent = write_some(write_buffer.data() + offset, remaining);
+		}
+		if (sent > 0) {
+			offset += sent;
+			update_activity();
+		}
+		return sent;
 	}
-	ssize_t sent = send(fd, write_buffer.data() + offset, remaining, 0);
-	if (sent > 0) {
-		offset += sent;
-		update_activity();
+
+	while (segment_index < body_segments.size()) {
+		const BodySegment& segment = body_segments[segment_index];
+		size_t left = segment.size() - segment_offset;
+		if (left == 0) {
+			++segment_index;
+			segment_offset = 0;
+			continue;
+		}
+
+		ssize_t sent;
+		if (segment.from_file) {
+			sent = send_file(segment.offset + static_cast<off_t>(segment_offset), left);
+		}
+		else if (!tls && segment_index + 1 < body_segments.size()) {
+			sent = send(fd, segment.data.data() + segment_offset, left, MSG_NOSIGNAL | MSG_MORE);
+		}
+		else {
+			sent = write_some(segment.data.data() + segment_offset, left);
+		}
+		if (sent > 0) {
+			segment_offset += sent;
+			if (segment_offset == segment.size()) {
+				++segment_index;
+				segment_offset = 0;
+			}
+			update_activity();
+		}
+		return sent;
+	}
+	return 0;
+}
+
+ssize_t Connection::send_file(off_t file_offset, size_t length) {
+	ssize_t sent;
+	if (!tls || tls->ktls_send()) {
+		// С kTLS ядро шифрует страницы файла само
+		off_t position = file_offset;
+		sent = sendfile(fd, body_file->fd, &position, std::min(length, SENDFILE_CHUNK));
+	}
+	else {
+		// Повтор после EAGAIN читает те же байты той же длины, как требует SSL_write
+		static thread_local char chunk[TLS_FILE_CHUNK];
+		sent = pread(body_file->fd, chunk, std::min(length, TLS_FILE_CHUNK), file_offset);
+		if (sent > 0) {
+			sent = tls->write(chunk, static_cast<size_t>(sent));
+		}
+	}
+	// Файл укоротили после открытия: Content-Length уже не выполнить
+	if (sent == 0) {
+		errno = EIO;
+		return -1;
 	}
 	return sent;
 }
@@ -48,13 +187,8 @@ void Connection::handle_keep_alive() {
 	/*std::cout << "[DEBUG] handle_keep_alive: fd=" << fd
 		<< ", handled=" << handled_request
 		<< ", max=" << max_requests << std::endl;*/
-	read_buffer.clear();
-	write_buffer.clear();
+	release_buffers();
 	offset = 0;
-	method.clear();
-	path.clear();
-	headers.clear();
-	body.clear();
 
 	handled_request++;
 	if (handled_request >= max_requests) {
@@ -67,11 +201,63 @@ void Connection::handle_keep_alive() {
 	state = ConnectionState::READING_REQUEST;
 	update_activity();
 }
+bool Connection::is_idle() const {
+	return state == ConnectionState::READING_REQUEST && read_buffer.empty();
+}
+
+void Connection::release_buffers() {
+	// clear() сохраняет ёмкость строки, swap с пустой строкой - нет
+	std::string().swap(read_buffer);
+	std::string().swap(write_buffer);
+	std::string().swap(method);
+	std::string().swap(http_version);
+	std::string().swap(path);
+	std::string().swap(body);
+	headers.clear();
+	body_file.reset();
+	std::vector<BodySegment>().swap(body_segments);
+	segment_index = 0;
+	segment_offset = 0;
+}
+
+namespace {
+
+size_t heap_size(const std::string& str) {
+	static const size_t inline_capacity = std::string().capacity();
+	return str.capacity() > inline_capacity ? str.capacity() + 1 : 0;
+}
+
+}
+
+size_t Connection::memory_usage() const {
+	// Узел ConnectionMap: указатели хеш-таблицы, ключ и unique_ptr
+	const size_t map_node = 4 * sizeof(void*);
+	const size_t header_node = sizeof(std::pair<const std::string, std::string>) + 4 * sizeof(void*);
+
+	size_t total = sizeof(Connection) + map_node;
+	total += heap_size(read_buffer) + heap_size(write_buffer);
+	total += heap_size(method) + heap_size(http_version) + heap_size(path) + heap_size(body);
+	for (const auto& [key, value] : headers) {
+		total += header_node + heap_size(key) + heap_size(value);
+	}
+	total += body_segments.capacity() * sizeof(BodySegment);
+	for (const BodySegment& segment : body_segments) {
+		total += heap_size(segment.data);
+	}
+	if (h2) {
+		total += h2->memory_usage();
+	}
+	if (ws) {
+		total += ws->memory_usage();
+	}
+	return total;
+}
+
 bool Connection::headers_receive() const {
 	return read_buffer.find("\r\n\r\n") != std::string::npos;
 }
 bool Connection::response_complete() const {
-	return offset >= write_buffer.size();
+	return offset >= write_buffer.size() && segment_index >= body_segments.size();
 }
 
 bool Connection::is_timed_out() const {
@@ -123,6 +309,11 @@ void Connection::update_activity() {
 
 void Connection::parse_connection_params() {
 
+	// HTTP/1.0 без заголовка Connection не держит соединение
+	if (http_version == "HTTP/1.0") {
+		keep_alive = false;
+	}
+
 	auto conn_it = headers.find("connection");
 	if (conn_it != headers.end()) {
 		std::string conn_val = conn_it->second;
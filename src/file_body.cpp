@@ -0,0 +1,42 @@
+#include "file_body.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FileBody::FileBody(int file_fd, off_t file_size, time_t modified) :
+    fd(file_fd),
+    size(file_size),
+    mtime(modified)
+{
+}
+
+FileBody::~FileBody() {
+    close(fd);
+}
+
+BodySegment BodySegment::memory(std::string bytes) {
+    BodySegment segment;
+    segment.data = std::move(bytes);
+    return segment;
+}
+
+BodySegment BodySegment::file_range(off_t offset, size_t length) {
+    BodySegment segment;
+    segment.offset = offset;
+    segment.length = length;
+    segment.from_file = true;
+    return segment;
+}
+
+std::shared_ptr<FileBody> open_file_body(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) == -1 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    return std::make_shared<FileBody>(fd, info.st_size, info.st_mtime);
+}
@@ -0,0 +1,157 @@
+#include "frame_pool.hpp"
+#include <atomic>
+#include <new>
+
+namespace {
+
+constexpr size_t NUM_CLASSES = FramePool::MAX_POOLED_SIZE / FramePool::GRANULARITY;
+
+struct FreeLists;
+
+// Заголовок перед кадром. 16 байт сохраняют выравнивание operator new
+struct alignas(16) BlockHeader {
+    FreeLists* owner;
+    size_t cls;
+};
+
+// Свободный блок связывается через первые байты кадра
+BlockHeader*& next_of(BlockHeader* block) {
+    return *reinterpret_cast<BlockHeader**>(block + 1);
+}
+
+// Стек возврата закрыт: поток-владелец завершился
+BlockHeader* const CLOSED = reinterpret_cast<BlockHeader*>(1);
+
+struct FreeLists {
+    BlockHeader* heads[NUM_CLASSES] = {};
+    size_t counts[NUM_CLASSES] = {};
+    // Блоки, освобождённые другими потоками (MPSC-стек): владелец
+    // забирает весь стек одним exchange, поэтому ABA не возникает
+    std::atomic<BlockHeader*> returned{ nullptr };
+    // Ссылки: поток-владелец и каждый его блок. Списки живут, пока
+    // кадр из чужого потока может к ним вернуться
+    std::atomic<size_t> references{ 1 };
+
+    void unref() {
+        if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    void free_block(BlockHeader* block) {
+        ::operator delete(block);
+        unref();
+    }
+
+    void push_local(BlockHeader* block) {
+        if (counts[block->cls] >= FramePool::MAX_CACHED_PER_CLASS) {
+            free_block(block);
+            return;
+        }
+        next_of(block) = heads[block->cls];
+        heads[block->cls] = block;
+        counts[block->cls]++;
+    }
+
+    void push_remote(BlockHeader* block) {
+        BlockHeader* head = returned.load(std::memory_order_relaxed);
+        do {
+            if (head == CLOSED) {
+                free_block(block);
+                return;
+            }
+            next_of(block) = head;
+        } while (!returned.compare_exchange_weak(head, block,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void take_returned(BlockHeader* block) {
+        while (block) {
+            BlockHeader* next = next_of(block);
+            push_local(block);
+            block = next;
+        }
+    }
+
+    void drain_returned() {
+        take_returned(returned.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    // Выход потока: кэш освобождается, поздние возвраты удаляются сразу
+    void release() {
+        take_returned(returned.exchange(CLOSED, std::memory_order_acq_rel));
+        for (size_t i = 0; i < NUM_CLASSES; ++i) {
+            while (heads[i]) {
+                BlockHeader* block = heads[i];
+                heads[i] = next_of(block);
+                free_block(block);
+            }
+            counts[i] = 0;
+        }
+        unref();
+    }
+};
+
+struct ListsHolder {
+    FreeLists* lists = new FreeLists;
+    ~ListsHolder() { lists->release(); }
+};
+
+thread_local ListsHolder holder;
+
+std::atomic<uint64_t> heap_allocations_count{ 0 };
+
+size_t size_class(size_t size) {
+    return (size + FramePool::GRANULARITY - 1) / FramePool::GRANULARITY - 1;
+}
+
+}
+
+void* FramePool::allocate(size_t size) {
+    if (size == 0 || size > MAX_POOLED_SIZE) {
+        heap_allocations_count.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    FreeLists& lists = *holder.lists;
+    size_t cls = size_class(size);
+    if (!lists.heads[cls]) {
+        lists.drain_returned();
+    }
+    BlockHeader* block = lists.heads[cls];
+    if (block) {
+        lists.heads[cls] = next_of(block);
+        lists.counts[cls]--;
+        return block + 1;
+    }
+
+    heap_allocations_count.fetch_add(1, std::memory_order_relaxed);
+    block = static_cast<BlockHeader*>(::operator new(sizeof(BlockHeader) + (cls + 1) * GRANULARITY));
+    lists.references.fetch_add(1, std::memory_order_relaxed);
+    block->owner = &lists;
+    block->cls = cls;
+    return block + 1;
+}
+
+void FramePool::deallocate(void* ptr, size_t size) {
+    if (!ptr) return;
+    if (size == 0 || size > MAX_POOLED_SIZE) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    // Кадр часто завершается не там, где создан (корутина закончилась
+    // в потоке реактора) - блок возвращается в список владельца
+    BlockHeader* block = static_cast<BlockHeader*>(ptr) - 1;
+    FreeLists* owner = block->owner;
+    if (owner == holder.lists) {
+        owner->push_local(block);
+    }
+    else {
+        owner->push_remote(block);
+    }
+}
+
+uint64_t FramePool::heap_allocations() {
+    return heap_allocations_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,49 @@
+#include "handler.hpp"
+
+RequestHandler request_handler = default_handler;
+
+const char* status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 101: return "Switching Protocols";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 416: return "Range Not Satisfiable";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+size_t Response::content_length() const {
+    if (!file) {
+        return body.size();
+    }
+    size_t length = 0;
+    for (const BodySegment& segment : segments) {
+        length += segment.size();
+    }
+    return length;
+}
+
+std::string Response::to_string() const {
+    std::string response = "HTTP/1.1 " + std::to_string(status) + " " + status_text(status) + "\r\n";
+    response += "Content-Type: " + content_type + "\r\n";
+    response += "Content-Length: " + std::to_string(content_length()) + "\r\n";
+    for (const auto& [name, value] : headers) {
+        response += name + ": " + value + "\r\n";
+    }
+    response += "\r\n";
+    response += body;
+    return response;
+}
+
+task<Response> default_handler(Request& request) {
+    Response response;
+    response.body = "Processed in thread pool. Path: " + request.path;
+    co_return response;
+}
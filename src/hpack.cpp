@@ -0,0 +1,409 @@
+#include "hpack.hpp"
+#include <unordered_map>
+
+namespace {
+
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t bits;
+};
+
+// RFC 7541, приложение B; символ 256 - EOS
+const HuffmanCode HUFFMAN_CODES[257] = {
+    { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 }, { 0xfffffe4, 28 },
+    { 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 }, { 0xfffffe8, 28 }, { 0xffffea, 24 },
+    { 0x3ffffffc, 30 }, { 0xfffffe9, 28 }, { 0xfffffea, 28 }, { 0x3ffffffd, 30 },
+    { 0xfffffeb, 28 }, { 0xfffffec, 28 }, { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 },
+    { 0xffffff0, 28 }, { 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 },
+    { 0xffffff4, 28 }, { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 }, { 0xffffff8, 28 },
+    { 0xffffff9, 28 }, { 0xffffffa, 28 }, { 0xffffffb, 28 }, { 0x14, 6 }, { 0x3f8, 10 },
+    { 0x3f9, 10 }, { 0xffa, 12 }, { 0x1ff9, 13 }, { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 },
+    { 0x3fa, 10 }, { 0x3fb, 10 }, { 0xf9, 8 }, { 0x7fb, 11 }, { 0xfa, 8 }, { 0x16, 6 },
+    { 0x17, 6 }, { 0x18, 6 }, { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 }, { 0x1a, 6 },
+    { 0x1b, 6 }, { 0x1c, 6 }, { 0x1d, 6 }, { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 }, { 0xfb, 8 },
+    { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 }, { 0x1ffa, 13 }, { 0x21, 6 },
+    { 0x5d, 7 }, { 0x5e, 7 }, { 0x5f, 7 }, { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 }, { 0x63, 7 },
+    { 0x64, 7 }, { 0x65, 7 }, { 0x66, 7 }, { 0x67, 7 }, { 0x68, 7 }, { 0x69, 7 }, { 0x6a, 7 },
+    { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 }, { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 },
+    { 0x72, 7 }, { 0xfc, 8 }, { 0x73, 7 }, { 0xfd, 8 }, { 0x1ffb, 13 }, { 0x7fff0, 19 },
+    { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 }, { 0x7ffd, 15 }, { 0x3, 5 }, { 0x23, 6 },
+    { 0x4, 5 }, { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 }, { 0x26, 6 }, { 0x27, 6 }, { 0x6, 5 },
+    { 0x74, 7 }, { 0x75, 7 }, { 0x28, 6 }, { 0x29, 6 }, { 0x2a, 6 }, { 0x7, 5 }, { 0x2b, 6 },
+    { 0x76, 7 }, { 0x2c, 6 }, { 0x8, 5 }, { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 },
+    { 0x79, 7 }, { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 }, { 0x7fc, 11 }, { 0x3ffd, 14 },
+    { 0x1ffd, 13 }, { 0xffffffc, 28 }, { 0xfffe6, 20 }, { 0x3fffd2, 22 }, { 0xfffe7, 20 },
+    { 0xfffe8, 20 }, { 0x3fffd3, 22 }, { 0x3fffd4, 22 }, { 0x3fffd5, 22 }, { 0x7fffd9, 23 },
+    { 0x3fffd6, 22 }, { 0x7fffda, 23 }, { 0x7fffdb, 23 }, { 0x7fffdc, 23 }, { 0x7fffdd, 23 },
+    { 0x7fffde, 23 }, { 0xffffeb, 24 }, { 0x7fffdf, 23 }, { 0xffffec, 24 }, { 0xffffed, 24 },
+    { 0x3fffd7, 22 }, { 0x7fffe0, 23 }, { 0xffffee, 24 }, { 0x7fffe1, 23 }, { 0x7fffe2, 23 },
+    { 0x7fffe3, 23 }, { 0x7fffe4, 23 }, { 0x1fffdc, 21 }, { 0x3fffd8, 22 }, { 0x7fffe5, 23 },
+    { 0x3fffd9, 22 }, { 0x7fffe6, 23 }, { 0x7fffe7, 23 }, { 0xffffef, 24 }, { 0x3fffda, 22 },
+    { 0x1fffdd, 21 }, { 0xfffe9, 20 }, { 0x3fffdb, 22 }, { 0x3fffdc, 22 }, { 0x7fffe8, 23 },
+    { 0x7fffe9, 23 }, { 0x1fffde, 21 }, { 0x7fffea, 23 }, { 0x3fffdd, 22 }, { 0x3fffde, 22 },
+    { 0xfffff0, 24 }, { 0x1fffdf, 21 }, { 0x3fffdf, 22 }, { 0x7fffeb, 23 }, { 0x7fffec, 23 },
+    { 0x1fffe0, 21 }, { 0x1fffe1, 21 }, { 0x3fffe0, 22 }, { 0x1fffe2, 21 }, { 0x7fffed, 23 },
+    { 0x3fffe1, 22 }, { 0x7fffee, 23 }, { 0x7fffef, 23 }, { 0xfffea, 20 }, { 0x3fffe2, 22 },
+    { 0x3fffe3, 22 }, { 0x3fffe4, 22 }, { 0x7ffff0, 23 }, { 0x3fffe5, 22 }, { 0x3fffe6, 22 },
+    { 0x7ffff1, 23 }, { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 }, { 0xfffeb, 20 }, { 0x7fff1, 19 },
+    { 0x3fffe7, 22 }, { 0x7ffff2, 23 }, { 0x3fffe8, 22 }, { 0x1ffffec, 25 }, { 0x3ffffe2, 26 },
+    { 0x3ffffe3, 26 }, { 0x3ffffe4, 26 }, { 0x7ffffde, 27 }, { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 },
+    { 0xfffff1, 24 }, { 0x1ffffed, 25 }, { 0x7fff2, 19 }, { 0x1fffe3, 21 }, { 0x3ffffe6, 26 },
+    { 0x7ffffe0, 27 }, { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 }, { 0x7ffffe2, 27 }, { 0xfffff2, 24 },
+    { 0x1fffe4, 21 }, { 0x1fffe5, 21 }, { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 }, { 0xffffffd, 28 },
+    { 0x7ffffe3, 27 }, { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 }, { 0xfffec, 20 }, { 0xfffff3, 24 },
+    { 0xfffed, 20 }, { 0x1fffe6, 21 }, { 0x3fffe9, 22 }, { 0x1fffe7, 21 }, { 0x1fffe8, 21 },
+    { 0x7ffff3, 23 }, { 0x3fffea, 22 }, { 0x3fffeb, 22 }, { 0x1ffffee, 25 }, { 0x1ffffef, 25 },
+    { 0xfffff4, 24 }, { 0xfffff5, 24 }, { 0x3ffffea, 26 }, { 0x7ffff4, 23 }, { 0x3ffffeb, 26 },
+    { 0x7ffffe6, 27 }, { 0x3ffffec, 26 }, { 0x3ffffed, 26 }, { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 },
+    { 0x7ffffe9, 27 }, { 0x7ffffea, 27 }, { 0x7ffffeb, 27 }, { 0xffffffe, 28 }, { 0x7ffffec, 27 },
+    { 0x7ffffed, 27 }, { 0x7ffffee, 27 }, { 0x7ffffef, 27 }, { 0x7fffff0, 27 }, { 0x3ffffee, 26 },
+    { 0x3fffffff, 30 },
+};
+
+const HeaderField STATIC_TABLE[] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+
+constexpr size_t STATIC_TABLE_SIZE = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+constexpr size_t ENTRY_OVERHEAD = 32;
+
+// Дерево декодирования Хаффмана: листья хранят символ
+struct HuffmanTree {
+    struct Node {
+        int16_t child[2] = { -1, -1 };
+        int16_t symbol = -1;
+    };
+    std::vector<Node> nodes;
+
+    HuffmanTree() {
+        nodes.emplace_back();
+        for (int symbol = 0; symbol < 257; ++symbol) {
+            const HuffmanCode& code = HUFFMAN_CODES[symbol];
+            size_t node = 0;
+            for (int bit = code.bits - 1; bit >= 0; --bit) {
+                int branch = (code.code >> bit) & 1;
+                if (nodes[node].child[branch] == -1) {
+                    nodes[node].child[branch] = static_cast<int16_t>(nodes.size());
+                    nodes.emplace_back();
+                }
+                node = nodes[node].child[branch];
+            }
+            nodes[node].symbol = static_cast<int16_t>(symbol);
+        }
+    }
+};
+
+const HuffmanTree& huffman_tree() {
+    static const HuffmanTree tree;
+    return tree;
+}
+
+// Индексы статической таблицы для быстрого поиска при кодировании
+struct StaticIndex {
+    std::unordered_map<std::string, size_t> names;
+    std::unordered_map<std::string, size_t> pairs;
+
+    StaticIndex() {
+        for (size_t i = 0; i < STATIC_TABLE_SIZE; ++i) {
+            names.emplace(STATIC_TABLE[i].name, i + 1);
+            if (!STATIC_TABLE[i].value.empty()) {
+                pairs.emplace(STATIC_TABLE[i].name + '\0' + STATIC_TABLE[i].value, i + 1);
+            }
+        }
+    }
+};
+
+const StaticIndex& static_index() {
+    static const StaticIndex index;
+    return index;
+}
+
+bool decode_integer(const uint8_t*& pos, const uint8_t* end, int prefix_bits, uint64_t& value) {
+    if (pos >= end) return false;
+    uint8_t max_prefix = static_cast<uint8_t>((1 << prefix_bits) - 1);
+    value = *pos++ & max_prefix;
+    if (value < max_prefix) return true;
+
+    int shift = 0;
+    while (pos < end) {
+        uint8_t byte = *pos++;
+        value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+        shift += 7;
+        if (shift > 28) return false;
+    }
+    return false;
+}
+
+bool decode_string(const uint8_t*& pos, const uint8_t* end, std::string& out) {
+    if (pos >= end) return false;
+    bool huffman = *pos & 0x80;
+    uint64_t length;
+    if (!decode_integer(pos, end, 7, length)) return false;
+    if (length > static_cast<uint64_t>(end - pos)) return false;
+
+    out.clear();
+    bool ok = huffman ? huffman_decode(pos, length, out)
+        : (out.assign(reinterpret_cast<const char*>(pos), length), true);
+    pos += length;
+    return ok;
+}
+
+void encode_integer(uint64_t value, int prefix_bits, uint8_t first_byte, std::string& out) {
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out.push_back(static_cast<char>(first_byte | value));
+        return;
+    }
+    out.push_back(static_cast<char>(first_byte | max_prefix));
+    value -= max_prefix;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void encode_string(const std::string& str, std::string& out) {
+    size_t huffman_length = huffman_encoded_length(str);
+    if (huffman_length < str.size()) {
+        encode_integer(huffman_length, 7, 0x80, out);
+        huffman_encode(str, out);
+    }
+    else {
+        encode_integer(str.size(), 7, 0x00, out);
+        out += str;
+    }
+}
+
+}
+
+bool huffman_decode(const uint8_t* data, size_t length, std::string& out) {
+    const HuffmanTree& tree = huffman_tree();
+    size_t node = 0;
+    int depth = 0;
+    bool all_ones = true;
+
+    for (size_t i = 0; i < length; ++i) {
+        for (int bit = 7; bit >= 0; --bit) {
+            int branch = (data[i] >> bit) & 1;
+            int16_t next = tree.nodes[node].child[branch];
+            if (next == -1) return false;
+            node = next;
+            depth++;
+            all_ones = all_ones && branch;
+
+            int16_t symbol = tree.nodes[node].symbol;
+            if (symbol != -1) {
+                if (symbol == 256) return false;   // EOS внутри строки запрещён
+                out.push_back(static_cast<char>(symbol));
+                node = 0;
+                depth = 0;
+                all_ones = true;
+            }
+        }
+    }
+    // Дополнение - не более 7 бит префикса EOS (единицы)
+    return depth <= 7 && all_ones;
+}
+
+size_t huffman_encoded_length(const std::string& input) {
+    size_t bits = 0;
+    for (unsigned char c : input) {
+        bits += HUFFMAN_CODES[c].bits;
+    }
+    return (bits + 7) / 8;
+}
+
+void huffman_encode(const std::string& input, std::string& out) {
+    uint64_t buffer = 0;
+    int buffered = 0;
+    for (unsigned char c : input) {
+        const HuffmanCode& code = HUFFMAN_CODES[c];
+        buffer = (buffer << code.bits) | code.code;
+        buffered += code.bits;
+        while (buffered >= 8) {
+            buffered -= 8;
+            out.push_back(static_cast<char>(buffer >> buffered));
+        }
+    }
+    if (buffered > 0) {
+        out.push_back(static_cast<char>((buffer << (8 - buffered)) | (0xff >> buffered)));
+    }
+}
+
+HpackDecoder::HpackDecoder(size_t max_table_size) :
+    max_table_size_(max_table_size),
+    settings_max_size_(max_table_size)
+{
+}
+
+bool HpackDecoder::lookup(uint64_t index, HeaderField& field) const {
+    if (index == 0) return false;
+    if (index <= STATIC_TABLE_SIZE) {
+        field = STATIC_TABLE[index - 1];
+        return true;
+    }
+    index -= STATIC_TABLE_SIZE + 1;
+    if (index >= dynamic_table_.size()) return false;
+    field = dynamic_table_[index];
+    return true;
+}
+
+void HpackDecoder::evict(size_t limit) {
+    while (table_size_ > limit && !dynamic_table_.empty()) {
+        const HeaderField& last = dynamic_table_.back();
+        table_size_ -= last.name.size() + last.value.size() + ENTRY_OVERHEAD;
+        dynamic_table_.pop_back();
+    }
+}
+
+void HpackDecoder::add(const HeaderField& field) {
+    size_t size = field.name.size() + field.value.size() + ENTRY_OVERHEAD;
+    if (size > max_table_size_) {
+        evict(0);
+        return;
+    }
+    evict(max_table_size_ - size);
+    dynamic_table_.push_front(field);
+    table_size_ += size;
+}
+
+HpackDecoder::Status HpackDecoder::decode(const uint8_t* data, size_t length, std::vector<HeaderField>& headers,
+    size_t max_list_size) {
+    const uint8_t* pos = data;
+    const uint8_t* end = data + length;
+    size_t list_size = 0;
+
+    while (pos < end) {
+        uint8_t byte = *pos;
+        HeaderField field;
+        uint64_t index;
+
+        if (byte & 0x80) {
+            // Индексированное поле
+            if (!decode_integer(pos, end, 7, index) || !lookup(index, field)) return Status::COMPRESSION_ERROR;
+            list_size += field.name.size() + field.value.size() + 32;
+            if (list_size > max_list_size) return Status::TOO_LARGE;
+            headers.push_back(std::move(field));
+        }
+        else if ((byte & 0xe0) == 0x20) {
+            // Изменение размера динамической таблицы
+            if (!decode_integer(pos, end, 5, index) || index > settings_max_size_) return Status::COMPRESSION_ERROR;
+            max_table_size_ = index;
+            evict(max_table_size_);
+        }
+        else {
+            // Литерал: с индексацией (01), без индексации (0000), никогда (0001)
+            bool indexing = (byte & 0xc0) == 0x40;
+            int prefix = indexing ? 6 : 4;
+            if (!decode_integer(pos, end, prefix, index)) return Status::COMPRESSION_ERROR;
+            if (index > 0) {
+                if (!lookup(index, field)) return Status::COMPRESSION_ERROR;
+            }
+            else if (!decode_string(pos, end, field.name)) {
+                return Status::COMPRESSION_ERROR;
+            }
+            if (!decode_string(pos, end, field.value)) return Status::COMPRESSION_ERROR;
+
+            if (indexing) add(field);
+            list_size += field.name.size() + field.value.size() + 32;
+            if (list_size > max_list_size) return Status::TOO_LARGE;
+            headers.push_back(std::move(field));
+        }
+    }
+    return Status::OK;
+}
+
+void HpackEncoder::encode(const std::string& name, const std::string& value, std::string& out) {
+    const StaticIndex& index = static_index();
+
+    auto pair = index.pairs.find(name + '\0' + value);
+    if (pair != index.pairs.end()) {
+        encode_integer(pair->second, 7, 0x80, out);
+        return;
+    }
+
+    // Литерал без индексации: таблица клиента не меняется
+    auto known = index.names.find(name);
+    if (known != index.names.end()) {
+        encode_integer(known->second, 4, 0x00, out);
+    }
+    else {
+        out.push_back(0x00);
+        encode_string(name, out);
+    }
+    encode_string(value, out);
+}
+
+void HpackEncoder::encode_status(int status, std::string& out) {
+    // :status 200, 204, 206, 304, 400, 404, 500 - индексы 8..14
+    static const int indexed[] = { 200, 204, 206, 304, 400, 404, 500 };
+    for (int i = 0; i < 7; ++i) {
+        if (indexed[i] == status) {
+            out.push_back(static_cast<char>(0x80 | (8 + i)));
+            return;
+        }
+    }
+    encode(":status", std::to_string(status), out);
+}
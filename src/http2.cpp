@@ -0,0 +1,787 @@
+#include "http2.hpp"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+const char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+enum FrameType : uint8_t {
+    FRAME_DATA = 0x0,
+    FRAME_HEADERS = 0x1,
+    FRAME_PRIORITY = 0x2,
+    FRAME_RST_STREAM = 0x3,
+    FRAME_SETTINGS = 0x4,
+    FRAME_PUSH_PROMISE = 0x5,
+    FRAME_PING = 0x6,
+    FRAME_GOAWAY = 0x7,
+    FRAME_WINDOW_UPDATE = 0x8,
+    FRAME_CONTINUATION = 0x9
+};
+
+enum FrameFlags : uint8_t {
+    FLAG_END_STREAM = 0x1,
+    FLAG_ACK = 0x1,
+    FLAG_END_HEADERS = 0x4,
+    FLAG_PADDED = 0x8,
+    FLAG_PRIORITY = 0x20
+};
+
+enum ErrorCode : uint32_t {
+    NO_ERROR = 0x0,
+    PROTOCOL_ERROR = 0x1,
+    INTERNAL_ERROR = 0x2,
+    FLOW_CONTROL_ERROR = 0x3,
+    STREAM_CLOSED = 0x5,
+    FRAME_SIZE_ERROR = 0x6,
+    REFUSED_STREAM = 0x7,
+    COMPRESSION_ERROR = 0x9,
+    ENHANCE_YOUR_CALM = 0xb
+};
+
+enum SettingsId : uint16_t {
+    SETTINGS_HEADER_TABLE_SIZE = 0x1,
+    SETTINGS_ENABLE_PUSH = 0x2,
+    SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+    SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+    SETTINGS_MAX_FRAME_SIZE = 0x5,
+    SETTINGS_MAX_HEADER_LIST_SIZE = 0x6
+};
+
+constexpr size_t FRAME_HEADER_SIZE = 9;
+constexpr size_t MAX_FRAME_SIZE = 16384;
+constexpr uint32_t MAX_CONCURRENT_STREAMS = 128;
+constexpr int64_t MAX_WINDOW = 0x7fffffff;
+constexpr size_t MAX_BODY_SIZE = 1 << 20;
+// Предел списка заголовков: и сжатого блока (поток CONTINUATION),
+// и распакованного (объявляется клиенту в SETTINGS)
+constexpr size_t MAX_HEADER_LIST_SIZE = 64 * 1024;
+constexpr int MAX_IOV = 64;
+// Кадры DATA дописываются в очередь, пока она меньше этого: тело
+// файла не читается в память целиком даже при больших окнах клиента
+constexpr size_t MAX_QUEUED_DATA = 256 * 1024;
+
+uint32_t read_u32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+void append_u32(std::string& out, uint32_t value) {
+    out.push_back(static_cast<char>(value >> 24));
+    out.push_back(static_cast<char>(value >> 16));
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value));
+}
+
+void append_frame_header(std::string& out, size_t length, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    out.push_back(static_cast<char>(length >> 16));
+    out.push_back(static_cast<char>(length >> 8));
+    out.push_back(static_cast<char>(length));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    append_u32(out, stream_id & 0x7fffffff);
+}
+
+// Убирает Pad Length и дополнение кадра; false - некорректное дополнение
+bool strip_padding(uint8_t flags, const uint8_t*& payload, size_t& length) {
+    if (!(flags & FLAG_PADDED)) return true;
+    if (length < 1) return false;
+    size_t padding = payload[0];
+    if (padding >= length) return false;
+    payload += 1;
+    length -= 1 + padding;
+    return true;
+}
+
+bool base64url_decode(const std::string& input, std::string& out) {
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : input) {
+        int value;
+        if (c >= 'A' && c <= 'Z') value = c - 'A';
+        else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') value = c - '0' + 52;
+        else if (c == '-' || c == '+') value = 62;
+        else if (c == '_' || c == '/') value = 63;
+        else if (c == '=') break;
+        else return false;
+
+        buffer = (buffer << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>(buffer >> bits));
+        }
+    }
+    return true;
+}
+
+// Заголовки HTTP/1.1, запрещённые в HTTP/2
+bool is_connection_header(const std::string& name) {
+    return name == "connection" || name == "keep-alive" || name == "transfer-encoding" ||
+        name == "upgrade" || name == "proxy-connection";
+}
+
+}
+
+Http2Stream::Http2Stream(uint32_t stream_id, int fd, int64_t initial_window) :
+    id(stream_id),
+    request(fd),
+    send_window(initial_window)
+{
+    request.http_version = "HTTP/2";
+}
+
+bool Http2Session::is_preface_prefix(const std::string& data) {
+    size_t length = std::min(data.size(), PREFACE_LENGTH);
+    return length > 0 && data.compare(0, length, PREFACE, length) == 0;
+}
+
+Http2Session::Http2Session(int fd) :
+    fd_(fd)
+{
+    queue_settings();
+}
+
+void Http2Session::queue_settings() {
+    std::string payload;
+    payload.push_back(0);
+    payload.push_back(SETTINGS_MAX_CONCURRENT_STREAMS);
+    append_u32(payload, MAX_CONCURRENT_STREAMS);
+    payload.push_back(0);
+    payload.push_back(SETTINGS_ENABLE_PUSH);
+    append_u32(payload, 0);
+    payload.push_back(0);
+    payload.push_back(SETTINGS_MAX_HEADER_LIST_SIZE);
+    append_u32(payload, MAX_HEADER_LIST_SIZE);
+    queue_frame(FRAME_SETTINGS, 0, 0, payload.data(), payload.size());
+}
+
+void Http2Session::queue_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const char* payload, size_t length) {
+    std::string frame;
+    frame.reserve(FRAME_HEADER_SIZE + length);
+    append_frame_header(frame, length, type, flags, stream_id);
+    if (length > 0) {
+        frame.append(payload, length);
+    }
+    output_bytes_ += frame.size();
+    output_.push_back(std::move(frame));
+}
+
+void Http2Session::reset_stream(uint32_t stream_id, uint32_t error_code) {
+    std::string payload;
+    append_u32(payload, error_code);
+    queue_frame(FRAME_RST_STREAM, 0, stream_id, payload.data(), payload.size());
+    streams_.erase(stream_id);
+}
+
+void Http2Session::go_away(uint32_t error_code) {
+    if (closing_) return;
+    std::string payload;
+    append_u32(payload, last_stream_id_);
+    append_u32(payload, error_code);
+    queue_frame(FRAME_GOAWAY, 0, 0, payload.data(), payload.size());
+    closing_ = true;
+}
+
+// RFC 9113 6.8: клиент больше не откроет потоков, но ждёт ответы на
+// уже открытые. Своего GOAWAY в ответ не шлём
+void Http2Session::handle_go_away(uint32_t last_stream_id, uint32_t error_code) {
+    peer_going_away_ = true;
+    peer_last_stream_id_ = last_stream_id;
+    if (error_code != NO_ERROR) {
+        // Клиент закрывается из-за ошибки - ответы ему не нужны
+        closing_ = true;
+    }
+}
+
+bool Http2Session::closing() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closing_ || (peer_going_away_ && streams_.empty());
+}
+
+size_t Http2Session::memory_usage() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t total = sizeof(Http2Session) + input_.capacity();
+    for (const std::string& chunk : output_) {
+        total += chunk.capacity();
+    }
+    for (const auto& [id, stream] : streams_) {
+        total += sizeof(Http2Stream);
+        for (const BodySegment& segment : stream->segments) {
+            total += segment.data.capacity();
+        }
+        // Запрос переданного потока читает обработчик в рабочем потоке
+        if (!stream->dispatched) {
+            total += stream->request.memory_usage();
+        }
+    }
+    return total;
+}
+
+void Http2Session::feed(const char* data, size_t length, std::vector<std::shared_ptr<Http2Stream>>& ready) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closing_ || closed_) return;
+    input_.append(data, length);
+
+    size_t pos = 0;
+    if (!preface_received_) {
+        if (!is_preface_prefix(input_)) {
+            go_away(PROTOCOL_ERROR);
+            return;
+        }
+        if (input_.size() < PREFACE_LENGTH) return;
+        pos = PREFACE_LENGTH;
+        preface_received_ = true;
+    }
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(input_.data());
+    while (!closing_ && input_.size() - pos >= FRAME_HEADER_SIZE) {
+        const uint8_t* header = bytes + pos;
+        size_t frame_length = (size_t(header[0]) << 16) | (size_t(header[1]) << 8) | header[2];
+        if (frame_length > MAX_FRAME_SIZE) {
+            go_away(FRAME_SIZE_ERROR);
+            break;
+        }
+        if (input_.size() - pos < FRAME_HEADER_SIZE + frame_length) break;
+
+        uint8_t type = header[3];
+        uint8_t flags = header[4];
+        uint32_t stream_id = read_u32(header + 5) & 0x7fffffff;
+        handle_frame(type, flags, stream_id, header + FRAME_HEADER_SIZE, frame_length, ready);
+        pos += FRAME_HEADER_SIZE + frame_length;
+    }
+    input_.erase(0, pos);
+}
+
+void Http2Session::handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id,
+    const uint8_t* payload, size_t length, std::vector<std::shared_ptr<Http2Stream>>& ready) {
+    // Блок заголовков нельзя прерывать другими кадрами
+    if (continuation_stream_ != 0 && type != FRAME_CONTINUATION) {
+        go_away(PROTOCOL_ERROR);
+        return;
+    }
+
+    switch (type) {
+    case FRAME_DATA:
+        handle_data(flags, stream_id, payload, length, ready);
+        break;
+
+    case FRAME_HEADERS:
+        handle_headers(flags, stream_id, payload, length, ready);
+        break;
+
+    case FRAME_CONTINUATION:
+        handle_continuation(flags, stream_id, payload, length, ready);
+        break;
+
+    case FRAME_PRIORITY:
+        if (stream_id == 0 || length != 5) go_away(PROTOCOL_ERROR);
+        break;
+
+    case FRAME_RST_STREAM:
+        if (stream_id == 0 || length != 4) {
+            go_away(PROTOCOL_ERROR);
+            break;
+        }
+        streams_.erase(stream_id);
+        break;
+
+    case FRAME_SETTINGS:
+        if (stream_id != 0) {
+            go_away(PROTOCOL_ERROR);
+            break;
+        }
+        if (flags & FLAG_ACK) break;
+        if (!apply_settings(payload, length)) break;
+        queue_frame(FRAME_SETTINGS, FLAG_ACK, 0, nullptr, 0);
+        break;
+
+    case FRAME_PING:
+        if (stream_id != 0 || length != 8) {
+            go_away(length != 8 ? FRAME_SIZE_ERROR : PROTOCOL_ERROR);
+            break;
+        }
+        if (!(flags & FLAG_ACK)) {
+            queue_frame(FRAME_PING, FLAG_ACK, 0, reinterpret_cast<const char*>(payload), length);
+        }
+        break;
+
+    case FRAME_GOAWAY:
+        if (stream_id != 0 || length < 8) {
+            go_away(stream_id != 0 ? PROTOCOL_ERROR : FRAME_SIZE_ERROR);
+            break;
+        }
+        handle_go_away(read_u32(payload) & 0x7fffffff, read_u32(payload + 4));
+        break;
+
+    case FRAME_WINDOW_UPDATE: {
+        if (length != 4) {
+            go_away(FRAME_SIZE_ERROR);
+            break;
+        }
+        int64_t increment = read_u32(payload) & 0x7fffffff;
+        if (stream_id == 0) {
+            if (increment == 0 || connection_send_window_ + increment > MAX_WINDOW) {
+                go_away(increment == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+                break;
+            }
+            connection_send_window_ += increment;
+            send_all_pending();
+            break;
+        }
+        auto it = streams_.find(stream_id);
+        if (it == streams_.end()) break;
+        if (increment == 0 || it->second->send_window + increment > MAX_WINDOW) {
+            reset_stream(stream_id, increment == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+            break;
+        }
+        it->second->send_window += increment;
+        send_pending(*it->second);
+        break;
+    }
+
+    case FRAME_PUSH_PROMISE:
+        // Клиент не может инициировать push
+        go_away(PROTOCOL_ERROR);
+        break;
+
+    default:
+        // Неизвестные типы кадров игнорируются
+        break;
+    }
+}
+
+bool Http2Session::apply_settings(const uint8_t* payload, size_t length) {
+    if (length % 6 != 0) {
+        go_away(FRAME_SIZE_ERROR);
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i += 6) {
+        uint16_t id = static_cast<uint16_t>((payload[i] << 8) | payload[i + 1]);
+        uint32_t value = read_u32(payload + i + 2);
+
+        switch (id) {
+        case SETTINGS_INITIAL_WINDOW_SIZE: {
+            if (value > MAX_WINDOW) {
+                go_away(FLOW_CONTROL_ERROR);
+                return false;
+            }
+            int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+            peer_initial_window_ = value;
+            for (auto& entry : streams_) {
+                entry.second->send_window += delta;
+            }
+            break;
+        }
+        case SETTINGS_MAX_FRAME_SIZE:
+            if (value < 16384 || value > 16777215) {
+                go_away(PROTOCOL_ERROR);
+                return false;
+            }
+            peer_max_frame_size_ = value;
+            break;
+        case SETTINGS_ENABLE_PUSH:
+            if (value > 1) {
+                go_away(PROTOCOL_ERROR);
+                return false;
+            }
+            break;
+        default:
+            // HEADER_TABLE_SIZE не влияет: кодировщик не использует
+            // динамическую таблицу
+            break;
+        }
+    }
+    send_all_pending();
+    return true;
+}
+
+void Http2Session::handle_headers(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length,
+    std::vector<std::shared_ptr<Http2Stream>>& ready) {
+    if (stream_id == 0 || stream_id % 2 == 0 || !strip_padding(flags, payload, length)) {
+        go_away(PROTOCOL_ERROR);
+        return;
+    }
+    if (flags & FLAG_PRIORITY) {
+        if (length < 5) {
+            go_away(PROTOCOL_ERROR);
+            return;
+        }
+        payload += 5;
+        length -= 5;
+    }
+
+    std::shared_ptr<Http2Stream> stream;
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        // Трейлеры: допустимы только с END_STREAM
+        stream = it->second;
+        if (stream->end_stream || !(flags & FLAG_END_STREAM)) {
+            go_away(PROTOCOL_ERROR);
+            return;
+        }
+    }
+    else {
+        if (stream_id <= last_stream_id_) {
+            go_away(PROTOCOL_ERROR);
+            return;
+        }
+        last_stream_id_ = stream_id;
+        stream = std::make_shared<Http2Stream>(stream_id, fd_, peer_initial_window_);
+        streams_.emplace(stream_id, stream);
+    }
+
+    if (!append_header_block(*stream, payload, length)) {
+        return;
+    }
+    if (flags & FLAG_END_STREAM) {
+        stream->end_stream = true;
+    }
+
+    if (flags & FLAG_END_HEADERS) {
+        end_headers(*stream, ready);
+    }
+    else {
+        continuation_stream_ = stream_id;
+    }
+}
+
+void Http2Session::handle_continuation(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length,
+    std::vector<std::shared_ptr<Http2Stream>>& ready) {
+    if (stream_id == 0 || stream_id != continuation_stream_) {
+        go_away(PROTOCOL_ERROR);
+        return;
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        go_away(PROTOCOL_ERROR);
+        return;
+    }
+
+    if (!append_header_block(*it->second, payload, length)) {
+        return;
+    }
+    if (flags & FLAG_END_HEADERS) {
+        continuation_stream_ = 0;
+        end_headers(*it->second, ready);
+    }
+}
+
+bool Http2Session::append_header_block(Http2Stream& stream, const uint8_t* payload, size_t length) {
+    // Бесконечная цепочка CONTINUATION иначе растит блок без предела
+    if (stream.header_block.size() + length > MAX_HEADER_LIST_SIZE) {
+        go_away(ENHANCE_YOUR_CALM);
+        return false;
+    }
+    stream.header_block.append(reinterpret_cast<const char*>(payload), length);
+    return true;
+}
+
+void Http2Session::end_headers(Http2Stream& stream, std::vector<std::shared_ptr<Http2Stream>>& ready) {
+    std::vector<HeaderField> fields;
+    const uint8_t* block = reinterpret_cast<const uint8_t*>(stream.header_block.data());
+    auto status = decoder_.decode(block, stream.header_block.size(), fields, MAX_HEADER_LIST_SIZE);
+    std::string().swap(stream.header_block);
+    if (status != HpackDecoder::Status::OK) {
+        // Недекодированный остаток рассинхронизирует HPACK - только закрытие
+        go_away(status == HpackDecoder::Status::TOO_LARGE ? ENHANCE_YOUR_CALM : COMPRESSION_ERROR);
+        return;
+    }
+
+    std::shared_ptr<Http2Stream> shared = streams_[stream.id];
+
+    // Блок декодирован (состояние HPACK синхронно) - теперь можно отказать
+    // новому потоку (не трейлерам). После GOAWAY клиента новые не принимаются
+    bool opening = !stream.dispatched && stream.request.path.empty();
+    if (opening && (peer_going_away_ || streams_.size() > MAX_CONCURRENT_STREAMS)) {
+        reset_stream(stream.id, REFUSED_STREAM);
+        return;
+    }
+
+    if (!stream.dispatched && stream.request.path.empty()) {
+        Request& request = stream.request;
+        for (HeaderField& field : fields) {
+            if (field.name == ":method") request.method = std::move(field.value);
+            else if (field.name == ":path") request.path = std::move(field.value);
+            else if (field.name == ":authority") request.headers["host"] = std::move(field.value);
+            else if (field.name[0] == ':') continue;
+            else {
+                auto& value = request.headers[field.name];
+                if (!value.empty()) {
+                    value += field.name == "cookie" ? "; " : ", ";
+                }
+                value += field.value;
+            }
+        }
+        if (request.method.empty() || request.path.empty()) {
+            reset_stream(stream.id, PROTOCOL_ERROR);
+            return;
+        }
+    }
+
+    if (stream.end_stream) {
+        request_ready(shared, ready);
+    }
+}
+
+void Http2Session::handle_data(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length,
+    std::vector<std::shared_ptr<Http2Stream>>& ready) {
+    if (stream_id == 0) {
+        go_away(PROTOCOL_ERROR);
+        return;
+    }
+
+    // Окно соединения возвращаем сразу, включая дополнение
+    if (length > 0) {
+        std::string increment;
+        append_u32(increment, static_cast<uint32_t>(length));
+        queue_frame(FRAME_WINDOW_UPDATE, 0, 0, increment.data(), increment.size());
+    }
+
+    size_t frame_length = length;
+    if (!strip_padding(flags, payload, length)) {
+        go_away(PROTOCOL_ERROR);
+        return;
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second->end_stream) {
+        if (stream_id > last_stream_id_) {
+            go_away(PROTOCOL_ERROR);
+        }
+        else {
+            reset_stream(stream_id, STREAM_CLOSED);
+        }
+        return;
+    }
+
+    Http2Stream& stream = *it->second;
+    if (stream.request.body.size() + length > MAX_BODY_SIZE) {
+        reset_stream(stream_id, REFUSED_STREAM);
+        return;
+    }
+    stream.request.body.append(reinterpret_cast<const char*>(payload), length);
+
+    if (flags & FLAG_END_STREAM) {
+        stream.end_stream = true;
+        request_ready(it->second, ready);
+    }
+    else if (frame_length > 0) {
+        std::string increment;
+        append_u32(increment, static_cast<uint32_t>(frame_length));
+        queue_frame(FRAME_WINDOW_UPDATE, 0, stream_id, increment.data(), increment.size());
+    }
+}
+
+void Http2Session::request_ready(const std::shared_ptr<Http2Stream>& stream,
+    std::vector<std::shared_ptr<Http2Stream>>& ready) {
+    if (stream->dispatched) return;
+    stream->dispatched = true;
+    ready.push_back(stream);
+}
+
+bool Http2Session::start_upgrade(const std::string& settings_base64, const Connection& request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::string settings;
+    if (!base64url_decode(settings_base64, settings) ||
+        !apply_settings(reinterpret_cast<const uint8_t*>(settings.data()), settings.size())) {
+        return false;
+    }
+
+    auto stream = std::make_shared<Http2Stream>(1, fd_, peer_initial_window_);
+    stream->request.method = request.method;
+    stream->request.path = request.path;
+    stream->request.headers = request.headers;
+    stream->request.body = request.body;
+    stream->end_stream = true;
+    stream->dispatched = true;
+
+    last_stream_id_ = 1;
+    streams_.emplace(1, stream);
+    upgrade_stream_ = stream;
+    return true;
+}
+
+std::shared_ptr<Http2Stream> Http2Session::take_upgrade_stream() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::move(upgrade_stream_);
+}
+
+bool Http2Session::submit_response(uint32_t stream_id, const Response& response) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+        return false;
+    }
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second->response_started) {
+        // Поток сброшен клиентом, пока работал обработчик
+        return false;
+    }
+    Http2Stream& stream = *it->second;
+    stream.response_started = true;
+
+    std::string block;
+    HpackEncoder::encode_status(response.status, block);
+    HpackEncoder::encode("content-type", response.content_type, block);
+    HpackEncoder::encode("content-length", std::to_string(response.content_length()), block);
+    for (const auto& [name, value] : response.headers) {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (is_connection_header(lower)) continue;
+        HpackEncoder::encode(lower, value, block);
+    }
+
+    // HEADERS и при необходимости CONTINUATION, не длиннее кадра клиента
+    bool has_body = response.content_length() > 0;
+    size_t offset = 0;
+    bool first = true;
+    do {
+        size_t chunk = std::min(block.size() - offset, peer_max_frame_size_);
+        bool last = offset + chunk == block.size();
+        uint8_t flags = last ? FLAG_END_HEADERS : 0;
+        if (first && !has_body) flags |= FLAG_END_STREAM;
+        queue_frame(first ? FRAME_HEADERS : FRAME_CONTINUATION, flags, stream_id, block.data() + offset, chunk);
+        offset += chunk;
+        first = false;
+    } while (offset < block.size());
+
+    if (!has_body) {
+        streams_.erase(it);
+        return true;
+    }
+    if (response.file) {
+        stream.file = response.file;
+        stream.segments = response.segments;
+        std::erase_if(stream.segments, [](const BodySegment& segment) { return segment.size() == 0; });
+    }
+    else {
+        stream.segments.push_back(BodySegment::memory(response.body));
+    }
+    send_pending(stream);
+    return true;
+}
+
+void Http2Session::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    closing_ = true;
+    streams_.clear();
+    upgrade_stream_.reset();
+    output_.clear();
+    output_offset_ = 0;
+    output_bytes_ = 0;
+}
+
+void Http2Session::send_pending(Http2Stream& stream) {
+    if (!stream.response_started) return;
+
+    while (stream.segment_index < stream.segments.size() && output_bytes_ < MAX_QUEUED_DATA &&
+        connection_send_window_ > 0 && stream.send_window > 0) {
+        const BodySegment& segment = stream.segments[stream.segment_index];
+        size_t remaining = segment.size() - stream.segment_offset;
+        size_t chunk = std::min<size_t>({ remaining, peer_max_frame_size_,
+            static_cast<size_t>(connection_send_window_), static_cast<size_t>(stream.send_window) });
+        bool last = chunk == remaining && stream.segment_index + 1 == stream.segments.size();
+        uint8_t flags = last ? FLAG_END_STREAM : 0;
+
+        if (!segment.from_file) {
+            queue_frame(FRAME_DATA, flags, stream.id, segment.data.data() + stream.segment_offset, chunk);
+        }
+        else {
+            // Кадр собирается прямо из файла, без промежуточного буфера
+            std::string frame;
+            append_frame_header(frame, chunk, FRAME_DATA, flags, stream.id);
+            frame.resize(FRAME_HEADER_SIZE + chunk);
+            size_t done = 0;
+            while (done < chunk) {
+                ssize_t n = pread(stream.file->fd, frame.data() + FRAME_HEADER_SIZE + done, chunk - done,
+                    segment.offset + static_cast<off_t>(stream.segment_offset + done));
+                if (n <= 0) break;
+                done += static_cast<size_t>(n);
+            }
+            if (done < chunk) {
+                // Файл укоротили после открытия: content-length уже не выполнить
+                reset_stream(stream.id, INTERNAL_ERROR);
+                return;
+            }
+            output_bytes_ += frame.size();
+            output_.push_back(std::move(frame));
+        }
+
+        stream.segment_offset += chunk;
+        if (stream.segment_offset == segment.size()) {
+            stream.segment_index++;
+            stream.segment_offset = 0;
+        }
+        connection_send_window_ -= chunk;
+        stream.send_window -= chunk;
+    }
+
+    if (stream.segment_index >= stream.segments.size()) {
+        // Ответ отправлен полностью - поток закрыт. Ключ копируется:
+        // erase может уничтожить сам поток
+        uint32_t stream_id = stream.id;
+        streams_.erase(stream_id);
+    }
+}
+
+void Http2Session::send_all_pending() {
+    std::vector<uint32_t> waiting;
+    for (const auto& [id, stream] : streams_) {
+        if (stream->response_started && stream->segment_index < stream->segments.size()) {
+            waiting.push_back(id);
+        }
+    }
+    std::sort(waiting.begin(), waiting.end());
+    for (uint32_t id : waiting) {
+        if (connection_send_window_ <= 0 || output_bytes_ >= MAX_QUEUED_DATA) break;
+        auto it = streams_.find(id);
+        if (it != streams_.end()) {
+            send_pending(*it->second);
+        }
+    }
+}
+
+int Http2Session::flush(Connection& conn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Очередь освобождается - дочитываем ожидающие тела
+    send_all_pending();
+    while (!output_.empty()) {
+        struct iovec iov[MAX_IOV];
+        int count = 0;
+        for (auto it = output_.begin(); it != output_.end() && count < MAX_IOV; ++it, ++count) {
+            size_t skip = count == 0 ? output_offset_ : 0;
+            iov[count].iov_base = const_cast<char*>(it->data()) + skip;
+            iov[count].iov_len = it->size() - skip;
+        }
+
+        ssize_t sent = conn.write_vector(iov, count);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 1;
+            return -1;
+        }
+
+        size_t consumed = static_cast<size_t>(sent);
+        while (consumed > 0 && !output_.empty()) {
+            size_t available = output_.front().size() - output_offset_;
+            if (consumed < available) {
+                output_offset_ += consumed;
+                break;
+            }
+            consumed -= available;
+            output_bytes_ -= output_.front().size();
+            output_.pop_front();
+            output_offset_ = 0;
+        }
+        send_all_pending();
+    }
+    return 0;
+}
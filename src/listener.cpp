@@ -0,0 +1,288 @@
+#include "listener.hpp"
+#include "tls.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+const char* DEFAULT_LISTEN = "0.0.0.0:8080";
+
+std::string trim(const std::string& value) {
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+int parse_number(const std::string& value, const std::string& address, int base = 10) {
+    char* end = nullptr;
+    long number = std::strtol(value.c_str(), &end, base);
+    if (value.empty() || *end != '\0' || number < 0) {
+        throw std::runtime_error("listener " + address + ": bad number '" + value + "'");
+    }
+    return static_cast<int>(number);
+}
+
+void apply_option(ListenerConfig& config, const std::string& option) {
+    size_t equals = option.find('=');
+    std::string name = option.substr(0, equals);
+    std::string value = equals == std::string::npos ? "" : option.substr(equals + 1);
+
+    if (name == "backlog") config.backlog = parse_number(value, config.address);
+    else if (name == "nodelay") config.nodelay = true;
+    else if (name == "defer_accept") config.defer_accept = parse_number(value, config.address);
+    else if (name == "fastopen") config.fastopen = parse_number(value, config.address);
+    else if (name == "tls") config.tls = true;
+    else if (name == "mode") config.mode = parse_number(value, config.address, 8);
+    else throw std::runtime_error("listener " + config.address + ": unknown option '" + name + "'");
+}
+
+ListenerConfig parse_listener(const std::string& address) {
+    ListenerConfig config;
+    config.address = address;
+
+    size_t question = address.find('?');
+    std::string location = address.substr(0, question);
+    if (question != std::string::npos) {
+        std::string options = address.substr(question + 1);
+        size_t pos = 0;
+        while (pos <= options.size()) {
+            size_t end = options.find('&', pos);
+            if (end == std::string::npos) end = options.size();
+            if (end > pos) {
+                apply_option(config, options.substr(pos, end - pos));
+            }
+            pos = end + 1;
+        }
+    }
+
+    if (location.compare(0, 5, "unix:") == 0) {
+        config.family = AF_UNIX;
+        config.path = location.substr(5);
+        if (!config.path.empty() && config.path[0] == '@') {
+            config.abstract = true;
+            config.path.erase(0, 1);
+        }
+        // Для абстрактного имени sun_path[0] занят нулевым байтом
+        if (config.path.empty() || config.path.size() + 1 > sizeof(sockaddr_un::sun_path)) {
+            throw std::runtime_error("listener " + address + ": bad unix socket path");
+        }
+        return config;
+    }
+
+    size_t colon = location.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::runtime_error("listener " + address + ": port is missing");
+    }
+    config.host = location.substr(0, colon);
+    config.port = parse_number(location.substr(colon + 1), address);
+    if (config.port > 65535) {
+        throw std::runtime_error("listener " + address + ": bad port");
+    }
+
+    if (config.host.size() >= 2 && config.host.front() == '[' && config.host.back() == ']') {
+        config.family = AF_INET6;
+        config.host = config.host.substr(1, config.host.size() - 2);
+    }
+    else {
+        config.family = AF_INET;
+        if (config.host.empty()) {
+            config.host = "0.0.0.0";
+        }
+    }
+    return config;
+}
+
+void set_option(int fd, int level, int name, int value, const ListenerConfig& config, const char* label) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) == -1) {
+        std::cerr << "[WARN] " << config.address << ": " << label << " failed: "
+            << strerror(errno) << std::endl;
+    }
+}
+
+[[noreturn]] void fail(int fd, const ListenerConfig& config, const char* call) {
+    std::string error = strerror(errno);
+    close(fd);
+    throw std::runtime_error(std::string(call) + " " + config.address + " failed: " + error);
+}
+
+// Файл сокета остался от завершившегося процесса: connect получает
+// ECONNREFUSED. Любой другой исход - сокет кто-то слушает (или статус
+// неизвестен), удалять его нельзя
+bool stale_socket_file(const struct sockaddr_un& address) {
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe == -1) {
+        return false;
+    }
+    bool stale = connect(probe, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) == -1 &&
+        errno == ECONNREFUSED;
+    close(probe);
+    return stale;
+}
+
+}
+
+std::vector<ListenerConfig> parse_listeners(const std::string& spec) {
+    std::vector<ListenerConfig> configs;
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) end = spec.size();
+        std::string address = trim(spec.substr(pos, end - pos));
+        if (!address.empty()) {
+            configs.push_back(parse_listener(address));
+        }
+        pos = end + 1;
+    }
+    if (configs.empty()) {
+        throw std::runtime_error("no listeners configured");
+    }
+    return configs;
+}
+
+Listener open_listener(const ListenerConfig& config) {
+    int fd = socket(config.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error("socket " + config.address + " failed: " + strerror(errno));
+    }
+
+    struct sockaddr_storage storage {};
+    socklen_t length = 0;
+
+    if (config.family == AF_UNIX) {
+        auto* address = reinterpret_cast<struct sockaddr_un*>(&storage);
+        address->sun_family = AF_UNIX;
+        if (config.abstract) {
+            std::memcpy(address->sun_path + 1, config.path.data(), config.path.size());
+            length = offsetof(struct sockaddr_un, sun_path) + 1 + config.path.size();
+        }
+        else {
+            std::memcpy(address->sun_path, config.path.data(), config.path.size());
+            length = sizeof(struct sockaddr_un);
+
+            // Файл от предыдущего запуска мешает bind; живой сервер на
+            // том же пути не трогаем
+            struct stat info {};
+            if (stat(config.path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+                if (!stale_socket_file(*address)) {
+                    errno = EADDRINUSE;
+                    fail(fd, config, "bind");
+                }
+                unlink(config.path.c_str());
+            }
+        }
+    }
+    else {
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (config.family == AF_INET6) {
+            // Отдельные слушатели IPv4 и IPv6 на одном порту не конфликтуют
+            set_option(fd, IPPROTO_IPV6, IPV6_V6ONLY, 1, config, "IPV6_V6ONLY");
+            auto* address = reinterpret_cast<struct sockaddr_in6*>(&storage);
+            address->sin6_family = AF_INET6;
+            address->sin6_port = htons(config.port);
+            if (inet_pton(AF_INET6, config.host.c_str(), &address->sin6_addr) != 1) {
+                close(fd);
+                throw std::runtime_error("listener " + config.address + ": bad IPv6 address");
+            }
+            length = sizeof(struct sockaddr_in6);
+        }
+        else {
+            auto* address = reinterpret_cast<struct sockaddr_in*>(&storage);
+            address->sin_family = AF_INET;
+            address->sin_port = htons(config.port);
+            if (inet_pton(AF_INET, config.host.c_str(), &address->sin_addr) != 1) {
+                close(fd);
+                throw std::runtime_error("listener " + config.address + ": bad IPv4 address");
+            }
+            length = sizeof(struct sockaddr_in);
+        }
+
+        // Записи TLS уходят сразу: с Nagle последняя запись рукопожатия
+        // TLS 1.2 ждёт отложенного ACK клиента (~40 мс)
+        if (config.nodelay || config.tls) {
+            set_option(fd, IPPROTO_TCP, TCP_NODELAY, 1, config, "TCP_NODELAY");
+        }
+        if (config.defer_accept > 0) {
+            set_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, config.defer_accept, config, "TCP_DEFER_ACCEPT");
+        }
+        if (config.fastopen > 0) {
+            set_option(fd, IPPROTO_TCP, TCP_FASTOPEN, config.fastopen, config, "TCP_FASTOPEN");
+        }
+    }
+
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&storage), length) == -1) {
+        fail(fd, config, "bind");
+    }
+    if (config.family == AF_UNIX && !config.abstract && config.mode >= 0 &&
+        chmod(config.path.c_str(), static_cast<mode_t>(config.mode)) == -1) {
+        fail(fd, config, "chmod");
+    }
+    if (listen(fd, config.backlog) == -1) {
+        fail(fd, config, "listen");
+    }
+
+    std::cout << "[INFO] Слушаю " << config.address << (config.tls ? " (TLS)" : "") << std::endl;
+    return Listener{ fd, config };
+}
+
+void close_listener(Listener& listener) {
+    if (listener.fd == -1) {
+        return;
+    }
+    close(listener.fd);
+    listener.fd = -1;
+    if (listener.config.family == AF_UNIX && !listener.config.abstract) {
+        unlink(listener.config.path.c_str());
+    }
+}
+
+const Listener* find_listener(const std::vector<Listener>& listeners, int fd) {
+    for (const Listener& listener : listeners) {
+        if (listener.fd == fd) {
+            return &listener;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<Listener> open_listeners_from_env() {
+    const char* spec = std::getenv("SERVER_LISTEN");
+    std::vector<ListenerConfig> configs = parse_listeners(spec ? spec : DEFAULT_LISTEN);
+
+    // Без SERVER_LISTEN сертификат включает TLS на слушателе по умолчанию
+    if (!spec && tls_enabled()) {
+        configs.front().tls = true;
+    }
+
+    std::vector<Listener> listeners;
+    try {
+        for (const ListenerConfig& config : configs) {
+            if (config.tls && !tls_enabled()) {
+                throw std::runtime_error("listener " + config.address + ": tls requires SERVER_TLS_CERT and SERVER_TLS_KEY");
+            }
+            listeners.push_back(open_listener(config));
+        }
+    }
+    catch (...) {
+        for (Listener& listener : listeners) {
+            close_listener(listener);
+        }
+        throw;
+    }
+    return listeners;
+}
@@ -0,0 +1,123 @@
+#include "placement.hpp"
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+PlacementPolicy PlacementPolicy::from_env() {
+    PlacementPolicy policy;
+
+    if (const char* value = std::getenv("SERVER_REACTOR_CPUS")) {
+        policy.reactor_cpus = parse_cpu_list(value);
+    }
+    if (const char* value = std::getenv("SERVER_WORKER_CPUS")) {
+        policy.worker_cpus = parse_cpu_list(value);
+    }
+    if (const char* value = std::getenv("SERVER_SHARDING")) {
+        std::string mode = value;
+        if (mode == "core") {
+            policy.shard_mode = ShardMode::PER_CORE;
+        }
+        else if (mode == "node") {
+            policy.shard_mode = ShardMode::PER_NODE;
+        }
+        else if (mode != "none") {
+            std::cerr << "[WARN] Неизвестный SERVER_SHARDING=" << mode << std::endl;
+        }
+    }
+    if (const char* value = std::getenv("SERVER_MATCH_INCOMING_CPU")) {
+        policy.match_incoming_cpu = std::strcmp(value, "1") == 0;
+    }
+    return policy;
+}
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream iss(list);
+    std::string range;
+
+    while (std::getline(iss, range, ',')) {
+        if (range.empty()) continue;
+        try {
+            size_t dash = range.find('-');
+            if (dash == std::string::npos) {
+                cpus.push_back(std::stoi(range));
+            }
+            else {
+                int first = std::stoi(range.substr(0, dash));
+                int last = std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        catch (...) {
+            std::cerr << "[WARN] Некорректный список CPU: " << range << std::endl;
+        }
+    }
+    return cpus;
+}
+
+int cpu_to_node(int cpu) {
+    // /sys/devices/system/cpu/cpuN/nodeM - ссылка на узел ядра
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return 0;
+    }
+
+    int node = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        if (std::strncmp(entry->d_name, "node", 4) == 0 &&
+            entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = std::atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+bool pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        std::cerr << "[WARN] sched_setaffinity failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool prefer_local_node(int node) {
+    if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8)) {
+        return false;
+    }
+
+    // Буферы, выделенные потоком, размещаются на его узле
+    unsigned long mask = 1UL << node;
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof(mask) * 8) == -1) {
+        std::cerr << "[WARN] set_mempolicy failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int current_cpu() {
+    return sched_getcpu();
+}
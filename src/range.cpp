@@ -0,0 +1,242 @@
+#include "range.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <random>
+#include <strings.h>
+
+namespace {
+
+// Больше диапазонов в одном запросе - признак атаки, Range игнорируется
+const size_t MAX_RANGES = 64;
+// Промежуток меньше заголовков ещё одной части дешевле отправить целиком
+const uint64_t COALESCE_GAP = 80;
+
+std::string trim(const std::string& value) {
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+const std::string* find_header(const Response& response, const char* name) {
+    for (const auto& [key, value] : response.headers) {
+        if (strcasecmp(key.c_str(), name) == 0) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+// Десятичное число без знака; слишком большое насыщается до UINT64_MAX
+bool parse_position(const std::string& text, uint64_t& value) {
+    if (text.empty()) {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        value = value > (UINT64_MAX - digit) / 10 ? UINT64_MAX : value * 10 + digit;
+    }
+    return true;
+}
+
+std::string content_range(const ByteRange& range, uint64_t size) {
+    return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) +
+        "/" + std::to_string(size);
+}
+
+std::string make_boundary() {
+    static thread_local std::mt19937_64 random{ std::random_device{}() };
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(random()));
+    return buffer;
+}
+
+}
+
+RangeStatus parse_range(const std::string& header, uint64_t size, std::vector<ByteRange>& ranges) {
+    ranges.clear();
+    std::string value = trim(header);
+    size_t equals = value.find('=');
+    if (equals == std::string::npos || strcasecmp(trim(value.substr(0, equals)).c_str(), "bytes") != 0) {
+        return RangeStatus::IGNORED;
+    }
+
+    size_t specs = 0;
+    size_t pos = equals + 1;
+    while (pos <= value.size()) {
+        size_t end = value.find(',', pos);
+        if (end == std::string::npos) end = value.size();
+        std::string spec = trim(value.substr(pos, end - pos));
+        pos = end + 1;
+        // Пустые элементы списка допустимы
+        if (spec.empty()) {
+            continue;
+        }
+        if (++specs > MAX_RANGES) {
+            return RangeStatus::IGNORED;
+        }
+
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos) {
+            return RangeStatus::IGNORED;
+        }
+        uint64_t first = 0;
+        uint64_t last = 0;
+        if (dash == 0) {
+            // Суффикс "-N": последние N байт
+            uint64_t suffix = 0;
+            if (!parse_position(spec.substr(1), suffix)) {
+                return RangeStatus::IGNORED;
+            }
+            if (suffix == 0 || size == 0) {
+                continue;
+            }
+            first = suffix >= size ? 0 : size - suffix;
+            last = size - 1;
+        }
+        else {
+            if (!parse_position(spec.substr(0, dash), first)) {
+                return RangeStatus::IGNORED;
+            }
+            last = UINT64_MAX;
+            if (dash + 1 < spec.size() && !parse_position(spec.substr(dash + 1), last)) {
+                return RangeStatus::IGNORED;
+            }
+            if (last < first) {
+                return RangeStatus::IGNORED;
+            }
+            if (first >= size) {
+                continue;
+            }
+            last = std::min(last, size - 1);
+        }
+        ranges.push_back(ByteRange{ first, last });
+    }
+
+    if (specs == 0) {
+        return RangeStatus::IGNORED;
+    }
+    if (ranges.empty()) {
+        return RangeStatus::UNSATISFIABLE;
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const ByteRange& a, const ByteRange& b) {
+        return a.first < b.first;
+        });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        ByteRange& current = ranges[merged];
+        if (ranges[i].first <= current.last + 1 + COALESCE_GAP) {
+            current.last = std::max(current.last, ranges[i].last);
+        }
+        else {
+            ranges[++merged] = ranges[i];
+        }
+    }
+    ranges.resize(merged + 1);
+    return RangeStatus::SATISFIABLE;
+}
+
+bool if_range_matches(const std::string& if_range, const Response& response) {
+    std::string validator = trim(if_range);
+    // Слабый тег не гарантирует побайтового совпадения
+    if (validator.compare(0, 2, "W/") == 0) {
+        return false;
+    }
+    if (!validator.empty() && validator.front() == '"') {
+        const std::string* etag = find_header(response, "etag");
+        return etag && *etag == validator;
+    }
+    const std::string* last_modified = find_header(response, "last-modified");
+    return last_modified && *last_modified == validator;
+}
+
+void apply_range(const Request& request, Response& response) {
+    if (request.method != "GET" || response.status != 200) {
+        return;
+    }
+    auto range = request.headers.find("range");
+    if (range == request.headers.end()) {
+        return;
+    }
+    const std::string* accept_ranges = find_header(response, "accept-ranges");
+    if (!accept_ranges || strcasecmp(accept_ranges->c_str(), "bytes") != 0) {
+        return;
+    }
+    // Тело из файла нарезается, только если это один непрерывный участок
+    if (response.file && response.segments.size() != 1) {
+        return;
+    }
+    auto if_range = request.headers.find("if-range");
+    if (if_range != request.headers.end() && !if_range_matches(if_range->second, response)) {
+        return;
+    }
+
+    uint64_t size = response.content_length();
+    std::vector<ByteRange> ranges;
+    RangeStatus status = parse_range(range->second, size, ranges);
+    if (status == RangeStatus::IGNORED) {
+        return;
+    }
+    if (status == RangeStatus::UNSATISFIABLE) {
+        response.status = 416;
+        response.headers.emplace_back("Content-Range", "bytes */" + std::to_string(size));
+        response.body.clear();
+        response.file.reset();
+        response.segments.clear();
+        return;
+    }
+
+    response.status = 206;
+    off_t base = response.file ? response.segments.front().offset : 0;
+
+    if (ranges.size() == 1) {
+        const ByteRange& only = ranges.front();
+        response.headers.emplace_back("Content-Range", content_range(only, size));
+        if (response.file) {
+            response.segments = { BodySegment::file_range(base + static_cast<off_t>(only.first), only.length()) };
+        }
+        else {
+            response.body = response.body.substr(only.first, only.length());
+        }
+        return;
+    }
+
+    // multipart/byteranges: у каждой части свои Content-Type и Content-Range
+    std::string boundary = make_boundary();
+    std::string part_type = response.content_type;
+    response.content_type = "multipart/byteranges; boundary=" + boundary;
+
+    std::vector<BodySegment> segments;
+    std::string body;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const ByteRange& part = ranges[i];
+        std::string head = (i == 0 ? "--" : "\r\n--") + boundary + "\r\n" +
+            "Content-Type: " + part_type + "\r\n" +
+            "Content-Range: " + content_range(part, size) + "\r\n\r\n";
+        if (response.file) {
+            segments.push_back(BodySegment::memory(std::move(head)));
+            segments.push_back(BodySegment::file_range(base + static_cast<off_t>(part.first), part.length()));
+        }
+        else {
+            body += head;
+            body.append(response.body, part.first, part.length());
+        }
+    }
+    std::string tail = "\r\n--" + boundary + "--\r\n";
+    if (response.file) {
+        segments.push_back(BodySegment::memory(std::move(tail)));
+        response.segments = std::move(segments);
+    }
+    else {
+        body += tail;
+        response.body = std::move(body);
+    }
+}
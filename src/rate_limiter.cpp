@@ -0,0 +1,185 @@
+#include "rate_limiter.hpp"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+uint64_t mix(uint64_t x) {
+    // splitmix64
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+}
+
+void RateLimiter::configure(double rate, double burst, size_t capacity) {
+    if (rate <= 0) {
+        table_.reset();
+        return;
+    }
+
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+
+    table_ = std::make_unique<Bucket[]>(size);
+    mask_ = size - 1;
+    refill_per_ms_ = rate * TOKEN_ONE / 1000.0;
+    burst_ = std::min<uint64_t>(static_cast<uint64_t>(std::max(burst, 1.0) * TOKEN_ONE), TOKEN_MASK);
+    full_refill_ms_ = static_cast<uint64_t>(burst_ / refill_per_ms_) + 1;
+
+    sketch_ = std::make_unique<std::atomic<uint32_t>[]>(SKETCH_DEPTH * SKETCH_WIDTH);
+    sketch_limit_ = static_cast<uint32_t>(rate + std::max(burst, 1.0));
+}
+
+uint64_t RateLimiter::now_ms() const {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool RateLimiter::allow(uint64_t key) {
+    if (!table_) return true;
+
+    uint64_t now = now_ms();
+    Bucket* bucket = find_bucket(key ? key : 1, now);
+    if (!bucket) {
+        return sketch_allow(key, now);
+    }
+    return take_token(*bucket, now);
+}
+
+RateLimiter::Bucket* RateLimiter::find_bucket(uint64_t key, uint64_t now) {
+    size_t start = mix(key) & mask_;
+
+    for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+        Bucket& bucket = table_[(start + i) & mask_];
+        uint64_t current = bucket.key.load(std::memory_order_acquire);
+        if (current == key) {
+            return &bucket;
+        }
+        if (current == 0) {
+            if (bucket.key.compare_exchange_strong(current, key, std::memory_order_acq_rel) ||
+                current == key) {
+                return &bucket;
+            }
+        }
+    }
+
+    // Окно пробирования занято: вытесняем ключ, корзина которого давно
+    // пополнилась до полной - для нового ключа её состояние корректно
+    for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+        Bucket& bucket = table_[(start + i) & mask_];
+        uint64_t last = bucket.state.load(std::memory_order_relaxed) >> TOKEN_BITS;
+        if (now - std::min(now, last) < full_refill_ms_) continue;
+
+        uint64_t current = bucket.key.load(std::memory_order_acquire);
+        if (bucket.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+            return &bucket;
+        }
+    }
+    return nullptr;
+}
+
+bool RateLimiter::take_token(Bucket& bucket, uint64_t now) {
+    uint64_t old_state = bucket.state.load(std::memory_order_relaxed);
+
+    while (true) {
+        uint64_t last = old_state >> TOKEN_BITS;
+        uint64_t tokens = old_state & TOKEN_MASK;
+        if (old_state == 0) {
+            tokens = burst_;
+            last = now;
+        }
+
+        // Время сдвигается, только когда начислен хотя бы один квант,
+        // иначе при малых rate дробные токены терялись бы
+        uint64_t elapsed = now > last ? now - last : 0;
+        uint64_t refill = static_cast<uint64_t>(elapsed * refill_per_ms_);
+        if (refill > 0) {
+            tokens = std::min(burst_, tokens + refill);
+            last = now;
+        }
+
+        bool allowed = tokens >= TOKEN_ONE;
+        if (allowed) {
+            tokens -= TOKEN_ONE;
+        }
+
+        uint64_t new_state = (last << TOKEN_BITS) | tokens;
+        if (bucket.state.compare_exchange_weak(old_state, new_state, std::memory_order_relaxed)) {
+            return allowed;
+        }
+    }
+}
+
+bool RateLimiter::sketch_allow(uint64_t key, uint64_t now) {
+    // Счётчики запросов за текущую секунду; сброс выполняет один поток
+    uint64_t window = now / 1000;
+    uint64_t current = sketch_window_.load(std::memory_order_relaxed);
+    if (current != window &&
+        sketch_window_.compare_exchange_strong(current, window, std::memory_order_relaxed)) {
+        for (size_t i = 0; i < SKETCH_DEPTH * SKETCH_WIDTH; ++i) {
+            sketch_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t hash = mix(key ^ 0x5bd1e995ULL);
+    uint32_t estimate = UINT32_MAX;
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+        size_t column = (hash >> (row * 16)) & (SKETCH_WIDTH - 1);
+        uint32_t count = sketch_[row * SKETCH_WIDTH + column].fetch_add(1, std::memory_order_relaxed) + 1;
+        estimate = std::min(estimate, count);
+    }
+    return estimate <= sketch_limit_;
+}
+
+uint64_t peer_key(const struct sockaddr_storage& address) {
+    if (address.ss_family == AF_INET) {
+        const auto* in = reinterpret_cast<const struct sockaddr_in*>(&address);
+        return (1ULL << 32) | in->sin_addr.s_addr;
+    }
+    if (address.ss_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const struct sockaddr_in6*>(&address);
+        // IPv4 на двухстековом слушателе (::ffff:a.b.c.d) - ключ как у IPv4
+        if (IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)) {
+            uint32_t v4;
+            std::memcpy(&v4, in6->sin6_addr.s6_addr + 12, 4);
+            return (1ULL << 32) | v4;
+        }
+        // Клиенту обычно выдаётся целая /64: младшие 64 бита он меняет
+        // свободно, поэтому ключ - только префикс сети
+        uint64_t prefix;
+        std::memcpy(&prefix, in6->sin6_addr.s6_addr, 8);
+        return mix(prefix);
+    }
+    return 0;
+}
+
+uint64_t unix_peer_key(int fd) {
+    struct ucred credentials {};
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == -1) {
+        return 0;
+    }
+    return (2ULL << 32) | credentials.uid;
+}
+
+uint64_t string_key(const std::string& value) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : value) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void parse_rate(const char* value, double& rate, double& burst) {
+    char* end = nullptr;
+    rate = std::strtod(value, &end);
+    burst = (end && *end == ':') ? std::strtod(end + 1, nullptr) : rate;
+}
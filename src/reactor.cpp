@@ -4,6 +4,7 @@
 #include <cerrno>
 #include <cstring>
 #include <iostream>
+#include <sys/epoll.h>
 
 Reactor::Reactor() {
 
@@ -16,6 +17,11 @@ Reactor::Reactor() {
         fcntl(pipe_[i], F_SETFL, flags | O_NONBLOCK);
     }
 
+    io_epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    if (io_epoll_ == -1) {
+        throw std::runtime_error("epoll_create1 failed: " + std::string(strerror(errno)));
+    }
+
     //std::cout << "[DEBUG] Reactor pipe created: read="
     //    << pipe_[0] << ", write=" << pipe_[1] << std::endl;
 }
@@ -23,10 +29,11 @@ Reactor::Reactor() {
 Reactor::~Reactor() {
     close(pipe_[0]);
     close(pipe_[1]);
+    close(io_epoll_);
 }
 
-void Reactor::notify(int fd, uint32_t events) {
-    ReactorNotification notification{ fd, events };
+void Reactor::notify(int fd, uint32_t events, uint64_t generation) {
+    ReactorNotification notification{ fd, events, generation };
 
 
     ssize_t written = write(pipe_[1], &notification, sizeof(notification));
@@ -60,4 +67,39 @@ bool Reactor::read_notification(ReactorNotification& notification) {
             << read_bytes << " bytes" << std::endl;
     }
     return false;
+}
+
+bool Reactor::wait_io(int fd, uint32_t events, std::coroutine_handle<> handle) {
+    struct epoll_event event {};
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = handle.address();
+
+    // EPOLLONESHOT оставляет fd зарегистрированным после срабатывания,
+    // поэтому повторное ожидание того же fd идёт через MOD
+    if (epoll_ctl(io_epoll_, EPOLL_CTL_ADD, fd, &event) == 0) {
+        return true;
+    }
+    if (errno == EEXIST && epoll_ctl(io_epoll_, EPOLL_CTL_MOD, fd, &event) == 0) {
+        return true;
+    }
+    std::cerr << "[ERROR] wait_io epoll_ctl failed: " << strerror(errno) << std::endl;
+    return false;
+}
+
+void Reactor::dispatch_io() {
+    const int MAX_IO_EVENTS = 64;
+    struct epoll_event events[MAX_IO_EVENTS];
+
+    while (true) {
+        int n = epoll_wait(io_epoll_, events, MAX_IO_EVENTS, 0);
+        if (n <= 0) {
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            std::coroutine_handle<>::from_address(events[i].data.ptr).resume();
+        }
+        if (n < MAX_IO_EVENTS) {
+            return;
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "scheduler.hpp"
+#include <strings.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+const SchedulingClass SCHEDULING_CLASSES[SCHED_CLASS_COUNT] = {
+    { "critical", 8 },
+    { "default", 4 },
+    { "bulk", 1 },
+};
+
+namespace {
+
+std::vector<std::pair<std::string, size_t>> route_classes = {
+    { "/health", CLASS_CRITICAL },
+    { "/ready", CLASS_CRITICAL },
+};
+
+// Повышение приоритета заголовком - только за доверенным прокси
+bool trust_priority = false;
+
+// Потолок X-Request-Timeout: дедлайн не уходит за пределы time_point
+std::chrono::milliseconds max_request_timeout{ 60000 };
+
+// Срок ожидания задачи без дедлайна при упорядочивании по EDF
+std::chrono::milliseconds default_budget{ 1000 };
+
+void read_milliseconds(const char* name, std::chrono::milliseconds& target) {
+    const char* value = std::getenv(name);
+    if (!value) return;
+    long ms = std::strtol(value, nullptr, 10);
+    if (ms > 0) {
+        target = std::chrono::milliseconds(ms);
+    }
+    else {
+        std::cerr << "[WARN] Некорректный " << name << "=" << value << std::endl;
+    }
+}
+
+// Класс по имени: critical, default, bulk
+size_t find_class(const std::string& name) {
+    for (size_t i = 0; i < SCHED_CLASS_COUNT; ++i) {
+        if (strcasecmp(name.c_str(), SCHEDULING_CLASSES[i].name) == 0) {
+            return i;
+        }
+    }
+    return SCHED_CLASS_COUNT;
+}
+
+// SERVER_ROUTE_CLASSES=/api/admin:critical,/export:bulk
+void parse_route_classes(const std::string& list) {
+    std::istringstream iss(list);
+    std::string entry;
+    while (std::getline(iss, entry, ',')) {
+        size_t start = entry.find_first_not_of(" \t");
+        if (start == std::string::npos) continue;
+        size_t end = entry.find_last_not_of(" \t");
+        entry = entry.substr(start, end - start + 1);
+
+        size_t colon = entry.rfind(':');
+        size_t sched_class = colon == std::string::npos
+            ? SCHED_CLASS_COUNT : find_class(entry.substr(colon + 1));
+        if (colon == 0 || sched_class == SCHED_CLASS_COUNT) {
+            std::cerr << "[WARN] SERVER_ROUTE_CLASSES: пропущено \"" << entry << "\"" << std::endl;
+            continue;
+        }
+        add_route_class(entry.substr(0, colon), sched_class);
+        std::cout << "[INFO] Маршрут " << entry.substr(0, colon) << " -> класс "
+            << SCHEDULING_CLASSES[sched_class].name << std::endl;
+    }
+}
+
+}
+
+void configure_scheduling_from_env() {
+    const char* value = std::getenv("SERVER_TRUST_PRIORITY");
+    trust_priority = value && std::strcmp(value, "1") == 0;
+    read_milliseconds("SERVER_MAX_REQUEST_TIMEOUT", max_request_timeout);
+    read_milliseconds("SERVER_DEFAULT_DEADLINE", default_budget);
+    if (const char* routes = std::getenv("SERVER_ROUTE_CLASSES")) {
+        parse_route_classes(routes);
+    }
+    if (trust_priority) {
+        std::cout << "[INFO] X-Priority: high принимается от клиентов" << std::endl;
+    }
+}
+
+bool find_raw_header(const std::string& raw, const char* name, std::string& value) {
+    size_t name_len = strlen(name);
+    size_t headers_end = raw.find("\r\n\r\n");
+    if (headers_end == std::string::npos) return false;
+
+    size_t pos = raw.find("\r\n");
+    while (pos != std::string::npos && pos < headers_end) {
+        size_t line = pos + 2;
+        size_t line_end = raw.find("\r\n", line);
+        if (line_end - line > name_len && raw[line + name_len] == ':' &&
+            strncasecmp(raw.data() + line, name, name_len) == 0) {
+            size_t start = raw.find_first_not_of(" \t", line + name_len + 1);
+            if (start == std::string::npos || start > line_end) start = line_end;
+            value = raw.substr(start, line_end - start);
+            return true;
+        }
+        pos = line_end;
+    }
+    return false;
+}
+
+void add_route_class(const std::string& prefix, size_t sched_class) {
+    if (sched_class < SCHED_CLASS_COUNT) {
+        route_classes.emplace_back(prefix, sched_class);
+    }
+}
+
+SchedClock::duration default_task_budget() {
+    return default_budget;
+}
+
+TaskOptions classify_request(const std::string& raw_request) {
+    TaskOptions options;
+
+    size_t path_start = raw_request.find(' ');
+    size_t path_end = path_start == std::string::npos
+        ? std::string::npos : raw_request.find(' ', path_start + 1);
+    if (path_end != std::string::npos) {
+        std::string_view path(raw_request.data() + path_start + 1, path_end - path_start - 1);
+        // Самый длинный подходящий префикс: /api/admin важнее /api
+        size_t matched = 0;
+        for (const auto& [prefix, sched_class] : route_classes) {
+            if (prefix.size() > matched && path.substr(0, prefix.size()) == prefix) {
+                options.sched_class = sched_class;
+                matched = prefix.size();
+            }
+        }
+    }
+
+    std::string value;
+    if (find_raw_header(raw_request, "x-priority", value)) {
+        // Понизить свой запрос может любой клиент, повысить - нет
+        if (strcasecmp(value.c_str(), "high") == 0 || strcasecmp(value.c_str(), "critical") == 0) {
+            if (trust_priority) {
+                options.sched_class = CLASS_CRITICAL;
+            }
+        }
+        else if (strcasecmp(value.c_str(), "low") == 0 || strcasecmp(value.c_str(), "bulk") == 0) {
+            options.sched_class = CLASS_BULK;
+        }
+    }
+
+    if (find_raw_header(raw_request, "x-request-timeout", value) ||
+        find_raw_header(raw_request, "request-timeout", value)) {
+        long timeout_ms = std::strtol(value.c_str(), nullptr, 10);
+        if (timeout_ms > 0) {
+            std::chrono::milliseconds timeout = std::min(std::chrono::milliseconds(timeout_ms),
+                max_request_timeout);
+            options.deadline = SchedClock::now() + timeout;
+        }
+    }
+
+    return options;
+}
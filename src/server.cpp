@@ -2,6 +2,17 @@
 #include "connection.hpp"
 #include "connection_map.hpp"
 #include "reactor.hpp"
+#include "handler.hpp"
+#include "rate_limiter.hpp"
+#include "http2.hpp"
+#include "websocket.hpp"
+#include "tls.hpp"
+#include "compression.hpp"
+#include "awaitables.hpp"
+#include "trace.hpp"
+#include "listener.hpp"
+#include "range.hpp"
+#include "frame_pool.hpp"
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
@@ -9,15 +20,85 @@
 #include <cerrno>
 #include <chrono>
 #include <netinet/in.h>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+size_t max_connections = 100;
+size_t memory_budget = 0;
+MemoryStats memory_stats;
+RateLimiter connection_limiter;
+RateLimiter request_limiter;
+RateLimiter key_limiter;
+std::string rate_limit_header;
+
+namespace {
+
+// Ping WebSocket после WS_PING_INTERVAL секунд тишины
+const int WS_PING_INTERVAL = 30;
+const int WS_PONG_TIMEOUT = 10;
+
+// Ответ 429 рендерится один раз и отправляется без участия рабочих потоков
+const std::string TOO_MANY_REQUESTS =
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 17\r\n"
+    "Retry-After: 1\r\n"
+    "\r\n"
+    "Too Many Requests";
+
+// Тот же ответ для отказа в accept и для клиента, не держащего keep-alive
+const std::string TOO_MANY_REQUESTS_CLOSE =
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 17\r\n"
+    "Retry-After: 1\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "Too Many Requests";
+
+bool request_allowed(Connection* conn) {
+    if (!request_limiter.allow(conn->peer_key)) {
+        return false;
+    }
+    if (key_limiter.enabled()) {
+        std::string value;
+        if (find_raw_header(conn->read_buffer, rate_limit_header.c_str(), value) &&
+            !key_limiter.allow(string_key(value))) {
+            return false;
+        }
+    }
+    return true;
+}
 
-const int MAX_CONNECTIONS = 100;
+// То же для потока HTTP/2: заголовки уже разобраны, имена в нижнем регистре
+bool stream_allowed(const Connection* conn, const Request& request) {
+    if (!request_limiter.allow(conn->peer_key)) {
+        return false;
+    }
+    if (key_limiter.enabled()) {
+        auto header = request.headers.find(rate_limit_header);
+        if (header != request.headers.end() && !key_limiter.allow(string_key(header->second))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
 
 ConnectionMap active_connections;
-ThreadPool worker_pool(std::thread::hardware_concurrency());
+WorkerShards worker_pool;
 Reactor reactor;
 
+namespace {
+
+uint64_t next_generation = 1;   // только поток реактора
+
+}
+
 Connection* create_connection(int fd, int epoll_fd) {
-    if (active_connections.size() >= MAX_CONNECTIONS) {
+    if (active_connections.size() >= max_connections) {
         std::cerr << "[WARN] Достигнут лимит соединений fd=" << fd << std::endl;
         close(fd);
         return nullptr;
@@ -30,6 +111,7 @@ Connection* create_connection(int fd, int epoll_fd) {
         close(fd);
         return nullptr;
     }
+    raw_ptr->generation = next_generation++;
     active_connections.insert(fd, std::move(conn));
 
     return raw_ptr;
@@ -45,9 +127,32 @@ void delete_connection(int fd, int epoll_fd) {
         close(fd);
         return;
     }
-    
+
+    // Обработчик ещё держит соединение, в том числе приостановленный
+    // на вводе-выводе. fd не закрываем, чтобы его номер не получил новый
+    // клиент; удаление завершится по уведомлению о готовом ответе
+    if (conn->busy) {
+        if (!conn->close_pending) {
+            conn->close_pending = true;
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            shutdown(fd, SHUT_RDWR);
+        }
+        return;
+    }
+
     epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
 
+    if (conn->ws) {
+        websocket_hub.unsubscribe_all(fd);
+    }
+    // Обработчики потоков держат сессию: ответы после закрытия отбрасываются
+    if (conn->h2) {
+        conn->h2->close();
+    }
+    if (conn->tls) {
+        conn->tls->shutdown();
+    }
+
     close(fd);
 
     active_connections.erase(fd);
@@ -56,19 +161,153 @@ void delete_connection(int fd, int epoll_fd) {
 }
 
 void check_connections(int epoll_fd) {
-    active_connections.for_each([epoll_fd](int fd, Connection* conn) {
-        if (conn && conn->should_close()) {
+    // Удаление под shared_lock обхода привело бы к взаимной блокировке
+    // с erase(), поэтому сначала собираем fd, потом закрываем
+    std::vector<int> expired;
+    std::vector<std::pair<time_t, int>> idle;
+    std::vector<int> websockets;
+    MemoryStats stats;
+
+    active_connections.for_each([&](int fd, Connection* conn) {
+        if (!conn) return;
+        // Заголовки, тело и ответ занятого соединения меняет рабочий
+        // поток: реактор не читает их до уведомления о готовом ответе
+        if (conn->busy) {
+            stats.busy_connections++;
+            return;
+        }
+        if (conn->should_close()) {
            /* std::cout << "[INFO] Закрытие по таймауту/лимиту fd=" << conn->fd
                 << " запросов=" << conn->handled_request
                 << " таймаут=" << conn->is_timed_out() << std::endl;*/
-            delete_connection(fd, epoll_fd);
+            expired.push_back(fd);
+            return;
+        }
+
+        if (conn->state == ConnectionState::WEBSOCKET) {
+            websockets.push_back(fd);
+        }
+
+        size_t bytes = conn->memory_usage();
+        if (conn->is_idle()) {
+            stats.idle_connections++;
+            stats.idle_bytes += bytes;
+            idle.emplace_back(conn->last_activity, fd);
+        }
+        else {
+            stats.active_connections++;
+            stats.active_bytes += bytes;
         }
         });
+
+    for (int fd : expired) {
+        delete_connection(fd, epoll_fd);
+    }
+
+    // Ping простаивающих WebSocket; без pong соединение закрывается
+    time_t now = time(nullptr);
+    for (int fd : websockets) {
+        Connection* conn = get_connection(fd);
+        if (!conn || !conn->ws) continue;
+        if (!conn->ws->check_alive(now, WS_PING_INTERVAL, WS_PONG_TIMEOUT)) {
+            delete_connection(fd, epoll_fd);
+            continue;
+        }
+        flush_websocket(conn, epoll_fd);
+    }
+
+    // Превышен бюджет памяти: закрываем самые давние простаивающие соединения
+    size_t total = stats.idle_bytes + stats.active_bytes;
+    if (memory_budget > 0 && total > memory_budget) {
+        std::sort(idle.begin(), idle.end());
+        size_t shed = 0;
+        for (const auto& [last_activity, fd] : idle) {
+            if (total <= memory_budget) break;
+            Connection* conn = get_connection(fd);
+            if (!conn || !conn->is_idle()) continue;
+
+            size_t bytes = conn->memory_usage();
+            delete_connection(fd, epoll_fd);
+            total -= std::min(total, bytes);
+            stats.idle_connections--;
+            stats.idle_bytes -= std::min(stats.idle_bytes, bytes);
+            shed++;
+        }
+        std::cerr << "[WARN] Бюджет памяти превышен, закрыто простаивающих соединений: "
+            << shed << std::endl;
+    }
+
+    memory_stats = stats;
+}
+
+void log_memory_stats() {
+    const MemoryStats& stats = memory_stats;
+    if (stats.idle_connections == 0 && stats.active_connections == 0 && stats.busy_connections == 0) return;
+
+    std::cout << "[MEM] idle=" << stats.idle_connections;
+    if (stats.idle_connections > 0) {
+        std::cout << " (" << stats.idle_bytes / stats.idle_connections << " B/conn)";
+    }
+    std::cout << " active=" << stats.active_connections;
+    if (stats.active_connections > 0) {
+        std::cout << " (" << stats.active_bytes / stats.active_connections << " B/conn)";
+    }
+    std::cout << " busy=" << stats.busy_connections;
+    std::cout << " total=" << stats.idle_bytes + stats.active_bytes << " B";
+    // Растёт только при прогреве пула кадров корутин
+    std::cout << " frame_mallocs=" << FramePool::heap_allocations();
+    if (memory_budget > 0) {
+        std::cout << " budget=" << memory_budget << " B";
+    }
+    std::cout << std::endl;
+}
+
+// "512", "64K", "256M", "2G"
+size_t parse_size(const char* value) {
+    char* end = nullptr;
+    unsigned long long size = std::strtoull(value, &end, 10);
+    switch (end ? *end : '\0') {
+    case 'G': case 'g': size <<= 30; break;
+    case 'M': case 'm': size <<= 20; break;
+    case 'K': case 'k': size <<= 10; break;
+    default: break;
+    }
+    return static_cast<size_t>(size);
 }
-void handle_new_connection(int server_fd, int epoll_fd) {
+
+void configure_limits_from_env() {
+    if (const char* value = std::getenv("SERVER_MAX_CONNECTIONS")) {
+        max_connections = parse_size(value);
+    }
+    if (const char* value = std::getenv("SERVER_MEMORY_BUDGET")) {
+        memory_budget = parse_size(value);
+    }
+
+    double rate = 0;
+    double burst = 0;
+    if (const char* value = std::getenv("SERVER_CONN_RATE")) {
+        parse_rate(value, rate, burst);
+        connection_limiter.configure(rate, burst);
+    }
+    if (const char* value = std::getenv("SERVER_REQUEST_RATE")) {
+        parse_rate(value, rate, burst);
+        request_limiter.configure(rate, burst);
+        if (const char* header = std::getenv("SERVER_RATE_KEY_HEADER")) {
+            rate_limit_header = header;
+            std::transform(rate_limit_header.begin(), rate_limit_header.end(),
+                rate_limit_header.begin(), ::tolower);
+            key_limiter.configure(rate, burst);
+        }
+    }
+}
+void handle_new_connection(const Listener& listener, int epoll_fd) {
     
     while (true) {
-        int client_fd = accept(server_fd, nullptr, nullptr);
+        struct sockaddr_storage peer {};
+        socklen_t peer_len = sizeof(peer);
+        // Принятый сокет сразу неблокирующий; TCP_NODELAY наследуется от слушателя
+        int client_fd = accept4(listener.fd, reinterpret_cast<struct sockaddr*>(&peer), &peer_len,
+            SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (client_fd == -1) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 // Нет больше ожидающих подключений
@@ -80,9 +319,48 @@ void handle_new_connection(int server_fd, int epoll_fd) {
 
         //std::cout << "[INFO] Новое подключение fd=" << client_fd << std::endl;
 
-        set_nonblocking(client_fd);
+        uint64_t key = peer.ss_family == AF_UNIX ? unix_peer_key(client_fd) : peer_key(peer);
+        if (!connection_limiter.allow(key)) {
+            // Открытый текст TLS-клиент принял бы за мусорную запись:
+            // на TLS-слушателе соединение сбрасывается (RST) без ответа
+            if (listener.config.tls) {
+                struct linger reset { 1, 0 };
+                setsockopt(client_fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+            }
+            else {
+                send(client_fd, TOO_MANY_REQUESTS_CLOSE.data(), TOO_MANY_REQUESTS_CLOSE.size(),
+                    MSG_DONTWAIT | MSG_NOSIGNAL);
+            }
+            close(client_fd);
+            continue;
+        }
 
         Connection* conn = create_connection(client_fd, epoll_fd);
+        if (!conn) {
+            continue;
+        }
+
+        int incoming_cpu = -1;
+        if (worker_pool.match_incoming_cpu()) {
+            socklen_t len = sizeof(incoming_cpu);
+            if (getsockopt(client_fd, SOL_SOCKET, SO_INCOMING_CPU, &incoming_cpu, &len) == -1) {
+                incoming_cpu = -1;
+            }
+        }
+        conn->shard = worker_pool.assign(client_fd, incoming_cpu);
+        conn->peer_key = key;
+
+        // Рукопожатие TLS начнётся с первым событием чтения
+        if (listener.config.tls) {
+            conn->tls = TlsSession::create(client_fd);
+            if (!conn->tls) {
+                std::cerr << "[ERROR] SSL_new failed fd=" << client_fd << std::endl;
+                delete_connection(client_fd, epoll_fd);
+                continue;
+            }
+        }
+
+        trace_accept(conn);
 
         struct epoll_event event {};
         event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
@@ -91,15 +369,47 @@ void handle_new_connection(int server_fd, int epoll_fd) {
     }
 }
 
+// Шаг неблокирующего рукопожатия TLS; true - можно читать запрос
+bool continue_handshake(Connection* conn, int epoll_fd) {
+    int status = conn->tls->handshake();
+    if (status < 0) {
+        delete_connection(conn->fd, epoll_fd);
+        return false;
+    }
+
+    struct epoll_event event {};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET |
+        (status == 0 && conn->tls->wants_write() ? EPOLLOUT : 0u);
+    event.data.ptr = conn;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+
+    if (status == 0) {
+        return false;
+    }
+    conn->update_activity();
+    return true;
+}
+
 void handle_read(Connection* conn, int epoll_fd) {
+    if (conn && conn->state == ConnectionState::HTTP2) {
+        handle_http2_read(conn, epoll_fd);
+        return;
+    }
+    if (conn && conn->state == ConnectionState::WEBSOCKET) {
+        handle_websocket_read(conn, epoll_fd);
+        return;
+    }
     if (!conn || conn->state != ConnectionState::READING_REQUEST) {
         std::cerr << "[ERROR] Неожиданное состояние в handle_readable" << std::endl;
         return;
     }
+    if (conn->tls && !conn->tls->established() && !continue_handshake(conn, epoll_fd)) {
+        return;
+    }
 
     char buffer[4096];
     while (true) {
-        ssize_t bytes_read = recv(conn->fd, buffer, sizeof(buffer), 0);
+        ssize_t bytes_read = conn->read_some(buffer, sizeof(buffer));
 
         if (bytes_read == -1) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -114,9 +424,37 @@ void handle_read(Connection* conn, int epoll_fd) {
             return;
         }
 
+        if (conn->read_buffer.empty()) {
+            trace_start(conn);
+        }
         conn->add_to_read(buffer, bytes_read);
 
+        // HTTP/2 с предварительным знанием: соединение начинается с preface
+        if (conn->handled_request == 0 && Http2Session::is_preface_prefix(conn->read_buffer)) {
+            if (conn->read_buffer.size() < Http2Session::PREFACE_LENGTH) {
+                continue;
+            }
+            start_http2(conn, epoll_fd);
+            return;
+        }
+
         if (conn->headers_receive()) {
+            trace_event(conn->trace_id, TracePhase::HEADERS_COMPLETE);
+
+            if (!request_allowed(conn)) {
+                // Keep-alive решает сам запрос (HTTP/1.0, Connection: close);
+                // неразобранный запрос - закрываем после 429
+                if (!conn->parse_headers()) {
+                    conn->keep_alive = false;
+                }
+                conn->set_response(conn->keep_alive ? TOO_MANY_REQUESTS : TOO_MANY_REQUESTS_CLOSE);
+
+                struct epoll_event event {};
+                event.events = EPOLLOUT | EPOLLRDHUP;
+                event.data.ptr = conn;
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+                break;
+            }
 
             struct epoll_event event {};
             event.events = EPOLLRDHUP | EPOLLET; 
@@ -124,9 +462,18 @@ void handle_read(Connection* conn, int epoll_fd) {
             epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
 
  
-            worker_pool.enqueue([conn, epoll_fd]() {
+            TaskOptions options = classify_request(conn->read_buffer);
+            options.on_expired = [conn]() {
+                reject_expired(conn);
+                };
+
+            trace_event(conn->trace_id, TracePhase::ENQUEUE);
+            // Снимается реактором, когда рабочий поток пришлёт уведомление
+            conn->busy = true;
+            worker_pool.shard(conn->shard).enqueue([conn, epoll_fd]() {
+                trace_event(conn->trace_id, TracePhase::DEQUEUE);
                 process_request(conn, epoll_fd);
-                });
+                }, std::move(options));
             break; 
         }
         }
@@ -134,40 +481,342 @@ void handle_read(Connection* conn, int epoll_fd) {
 
     }
 
+namespace {
+
+const std::string SWITCHING_PROTOCOLS =
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Connection: Upgrade\r\n"
+    "Upgrade: h2c\r\n"
+    "\r\n";
+
+// Исключение обработчика превращается в ответ 500.
+// Тело сжимается по Accept-Encoding в рабочем потоке, даже если
+// обработчик возобновился в реакторе после ожидания ввода-вывода.
+// Range применяется к выбранному представлению, уже сжатому
+task<Response> invoke_handler(Request& request) {
+    Response response;
+    try {
+        if (is_trace_request(request.path)) {
+            response.content_type = "application/json";
+            response.body = trace_json();
+        }
+        else {
+            response = co_await request_handler(request);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[ERROR] Exception in request handler: " << e.what() << std::endl;
+        response = Response{};
+        response.status = 500;
+        response.body = status_text(500);
+    }
+
+    auto accept_encoding = request.headers.find("accept-encoding");
+    Encoding encoding = choose_encoding(response,
+        accept_encoding != request.headers.end() ? accept_encoding->second : std::string());
+    if (encoding != Encoding::IDENTITY && !ThreadPool::on_worker_thread()) {
+        co_await offload(worker_pool.shard(request.shard));
+    }
+    apply_encoding(response, encoding);
+    apply_range(request, response);
+    co_return response;
+}
+
+// Запускает прикладной обработчик; кадр корутины живёт до отправки ответа
+// в реактор, даже если обработчик приостанавливался на вводе-выводе
+detached_task run_handler(Connection* conn, std::chrono::steady_clock::time_point start) {
+    trace_event(conn->trace_id, TracePhase::HANDLER_START);
+    Response response = co_await invoke_handler(*conn);
+    trace_event(conn->trace_id, TracePhase::HANDLER_END);
+
+    auto end = std::chrono::steady_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+    std::cout << "[PERF] process_request fd=" << conn->fd
+        << " took " << duration.count() << " μs" << std::endl;
+
+    conn->set_response(response.to_string());
+    if (response.file) {
+        conn->set_body(std::move(response.file), std::move(response.segments));
+    }
+
+    trace_event(conn->trace_id, TracePhase::NOTIFY);
+    reactor.notify(conn->fd, EPOLLOUT, conn->generation);
+}
+
+// Соединение HTTP/2 не ждёт обработчиков и может закрыться раньше:
+// поток держит только сессию, а реактор находит соединение по fd и номеру
+detached_task run_stream_handler(std::shared_ptr<Http2Session> session, std::shared_ptr<Http2Stream> stream,
+    int fd, uint64_t generation) {
+    Response response = co_await invoke_handler(stream->request);
+    if (session->submit_response(stream->id, response)) {
+        reactor.notify(fd, EPOLLOUT, generation);
+    }
+}
+
+// h2c через Upgrade: запрос становится потоком 1 новой сессии,
+// клиент получает 101 и дальше говорит на HTTP/2
+bool upgrade_to_http2(Connection* conn) {
+    auto upgrade = conn->headers.find("upgrade");
+    auto settings = conn->headers.find("http2-settings");
+    if (upgrade == conn->headers.end() || settings == conn->headers.end() ||
+        upgrade->second.find("h2c") == std::string::npos) {
+        return false;
+    }
+
+    auto session = std::make_shared<Http2Session>(conn->fd);
+    if (!session->start_upgrade(settings->second, *conn)) {
+        return false;
+    }
+    conn->h2 = std::move(session);
+    conn->set_response(SWITCHING_PROTOCOLS);
+    reactor.notify(conn->fd, EPOLLOUT, conn->generation);
+    return true;
+}
+
+}
+
+// Рукопожатие WebSocket (RFC 6455, 4.2)
+bool upgrade_to_websocket(Connection* conn) {
+    auto upgrade = conn->headers.find("upgrade");
+    auto key = conn->headers.find("sec-websocket-key");
+    auto version = conn->headers.find("sec-websocket-version");
+    if (conn->method != "GET" || upgrade == conn->headers.end() || key == conn->headers.end() ||
+        version == conn->headers.end() || version->second != "13") {
+        return false;
+    }
+    std::string protocol = upgrade->second;
+    std::transform(protocol.begin(), protocol.end(), protocol.begin(), ::tolower);
+    if (protocol.find("websocket") == std::string::npos) {
+        return false;
+    }
+
+    conn->ws = std::make_shared<WsSession>(conn->path);
+    conn->set_response("HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + websocket_accept_key(key->second) + "\r\n"
+        "\r\n");
+    reactor.notify(conn->fd, EPOLLOUT, conn->generation);
+    return true;
+}
+
+void reject_expired(Connection* conn) {
+    std::string response = "HTTP/1.1 503 Service Unavailable\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 16\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "Deadline expired";
+    conn->keep_alive = false;
+    conn->set_response(response);
+    reactor.notify(conn->fd, EPOLLOUT, conn->generation);
+}
+
 void process_request(Connection* conn, int epoll_fd) {
     auto start = std::chrono::steady_clock::now();
     bool parse_success = conn->parse_headers();
 
-    std::string response;
     if (!parse_success) {
-        response = "HTTP/1.1 400 Bad Request\r\n"
+        std::string response = "HTTP/1.1 400 Bad Request\r\n"
             "Content-Type: text/plain\r\n"
             "Content-Length: 11\r\n"
             "\r\n"
             "Bad Request";
+        conn->set_response(response);
+        reactor.notify(conn->fd, EPOLLOUT, conn->generation);
+        return;
     }
-    else {
-      
-        std::string body = "Processed in thread pool. Path: " + conn->path;
-        response = "HTTP/1.1 200 OK\r\n"
-            "Content-Type: text/plain\r\n"
-            "Content-Length: " + std::to_string(body.length()) + "\r\n"
-            "\r\n" + body;
+
+    if (upgrade_to_http2(conn) || upgrade_to_websocket(conn)) {
+        return;
     }
-    auto end = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 
-    std::cout << "[PERF] process_request fd=" << conn->fd
-        << " took " << duration.count() << " μs" << std::endl;
+    run_handler(conn, start);
+}
 
-    conn->set_response(response);
+void start_http2(Connection* conn, int epoll_fd) {
+    conn->h2 = std::make_shared<Http2Session>(conn->fd);
+    conn->state = ConnectionState::HTTP2;
+    // Preface начал трассу как запрос HTTP/1.1; потоки HTTP/2 не трассируются
+    conn->trace_id = 0;
+
+    std::string received;
+    received.swap(conn->read_buffer);
+    conn->release_buffers();
+
+    std::vector<std::shared_ptr<Http2Stream>> ready;
+    conn->h2->feed(received.data(), received.size(), ready);
+    dispatch_streams(conn, ready);
+
+    handle_http2_read(conn, epoll_fd);
+}
+
+void switch_to_http2(Connection* conn, int epoll_fd) {
+    conn->state = ConnectionState::HTTP2;
+    // Трасса запроса с Upgrade не продолжается на потоки сессии
+    conn->trace_id = 0;
+    conn->release_buffers();
+    conn->offset = 0;
+
+    std::vector<std::shared_ptr<Http2Stream>> ready;
+    if (auto stream = conn->h2->take_upgrade_stream()) {
+        ready.push_back(std::move(stream));
+    }
+    dispatch_streams(conn, ready);
+    flush_http2(conn, epoll_fd);
+}
+
+void handle_http2_read(Connection* conn, int epoll_fd) {
+    char buffer[16384];
+    std::vector<std::shared_ptr<Http2Stream>> ready;
+
+    while (true) {
+        ssize_t bytes_read = conn->read_some(buffer, sizeof(buffer));
+        if (bytes_read == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            std::cerr << "[ERROR] recv failed: " << strerror(errno) << std::endl;
+            delete_connection(conn->fd, epoll_fd);
+            return;
+        }
+        else if (bytes_read == 0) {
+            delete_connection(conn->fd, epoll_fd);
+            return;
+        }
+
+        conn->update_activity();
+        conn->h2->feed(buffer, bytes_read, ready);
+    }
+
+    dispatch_streams(conn, ready);
+    flush_http2(conn, epoll_fd);
+}
+
+void dispatch_streams(Connection* conn, std::vector<std::shared_ptr<Http2Stream>>& ready) {
+    for (auto& stream : ready) {
+        // Запрос потока - отдельный объект: шард и адрес берутся у соединения
+        stream->request.shard = conn->shard;
+        stream->request.peer_key = conn->peer_key;
+
+        if (!stream_allowed(conn, stream->request)) {
+            Response response;
+            response.status = 429;
+            response.headers.emplace_back("retry-after", "1");
+            response.body = status_text(429);
+            conn->h2->submit_response(stream->id, response);
+            continue;
+        }
+
+        worker_pool.shard(conn->shard).enqueue([session = conn->h2, stream,
+            fd = conn->fd, generation = conn->generation]() {
+            run_stream_handler(session, stream, fd, generation);
+            });
+    }
+}
+
+void flush_http2(Connection* conn, int epoll_fd) {
+    int status = conn->h2->flush(*conn);
+    if (status < 0 || (status == 0 && conn->h2->closing())) {
+        delete_connection(conn->fd, epoll_fd);
+        return;
+    }
 
-    reactor.notify(conn->fd, EPOLLOUT);
+    // EPOLLOUT нужен, только пока в очереди остались кадры
+    struct epoll_event event {};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (status > 0 ? EPOLLOUT : 0u);
+    event.data.ptr = conn;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
 }
 
 
 
+void switch_to_websocket(Connection* conn, int epoll_fd) {
+    conn->state = ConnectionState::WEBSOCKET;
+    // Сообщения WebSocket не относятся к трассе запроса с Upgrade
+    conn->trace_id = 0;
+    conn->release_buffers();
+    conn->offset = 0;
+
+    websocket_hub.subscribe(conn->ws->topic(), conn->fd, conn->ws);
+    flush_websocket(conn, epoll_fd);
+}
+
+void handle_websocket_read(Connection* conn, int epoll_fd) {
+    char buffer[16384];
+    std::vector<WsMessage> messages;
+
+    while (true) {
+        ssize_t bytes_read = conn->read_some(buffer, sizeof(buffer));
+        if (bytes_read == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            std::cerr << "[ERROR] recv failed: " << strerror(errno) << std::endl;
+            delete_connection(conn->fd, epoll_fd);
+            return;
+        }
+        else if (bytes_read == 0) {
+            delete_connection(conn->fd, epoll_fd);
+            return;
+        }
+
+        conn->update_activity();
+        conn->ws->feed(buffer, bytes_read, messages);
+    }
+
+    for (WsMessage& message : messages) {
+        websocket_handler(*conn, message);
+    }
+    flush_websocket(conn, epoll_fd);
+}
+
+void flush_websocket(Connection* conn, int epoll_fd) {
+    // Клиент не успевает забирать рассылку - отключаем
+    if (conn->ws->overflowed()) {
+        delete_connection(conn->fd, epoll_fd);
+        return;
+    }
+
+    int status = conn->ws->flush(*conn);
+    if (status < 0 || (status == 0 && conn->ws->closing())) {
+        delete_connection(conn->fd, epoll_fd);
+        return;
+    }
+
+    struct epoll_event event {};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (status > 0 ? EPOLLOUT : 0u);
+    event.data.ptr = conn;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+void flush_websockets(int epoll_fd) {
+    std::vector<int> dirty = websocket_hub.take_dirty();
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+    for (int fd : dirty) {
+        Connection* conn = get_connection(fd);
+        if (conn && conn->state == ConnectionState::WEBSOCKET) {
+            flush_websocket(conn, epoll_fd);
+        }
+    }
+}
+
 void handle_write(Connection* conn, int epoll_fd) {
+    if (conn && conn->tls && !conn->tls->established()) {
+        handle_read(conn, epoll_fd);
+        return;
+    }
+    if (conn && conn->state == ConnectionState::HTTP2) {
+        flush_http2(conn, epoll_fd);
+        return;
+    }
+    if (conn && conn->state == ConnectionState::WEBSOCKET) {
+        flush_websocket(conn, epoll_fd);
+        return;
+    }
     if (!conn || conn->state != ConnectionState::WRITING_RESPONSE) {
         return;
     }
@@ -184,11 +833,24 @@ void handle_write(Connection* conn, int epoll_fd) {
         }
         if (sent == 0) { break; }
         if (conn->response_complete()) {
+            trace_event(conn->trace_id, TracePhase::LAST_BYTE);
+            // Трасса запроса закончена; следующий получит свою в trace_start
+            conn->trace_id = 0;
             /*std::cout << "[DEBUG] Ответ отправлен полностью для fd=" << conn->fd
                 << ", keep-alive=" << conn->keep_alive
                 << ", requests=" << conn->handled_request
                 << "/" << conn->max_requests << std::endl;*/
 
+            // Отправлен 101 Switching Protocols
+            if (conn->h2) {
+                switch_to_http2(conn, epoll_fd);
+                break;
+            }
+            if (conn->ws) {
+                switch_to_websocket(conn, epoll_fd);
+                break;
+            }
+
             if (conn->keep_alive && !conn->should_close()) {
                 conn->handle_keep_alive();
 
@@ -199,6 +861,10 @@ void handle_write(Connection* conn, int epoll_fd) {
                 if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event) == -1) {
                     delete_connection(conn->fd, epoll_fd);
                 }
+                // Следующий запрос уже расшифрован и лежит в буфере TLS
+                else if (conn->has_buffered_input()) {
+                    handle_read(conn, epoll_fd);
+                }
                 /*else {
                     std::cout << "[DEBUG] Keep-alive: fd=" << conn->fd
                         << " переключен на чтение" << std::endl;
@@ -227,31 +893,3 @@ void set_nonblocking(int fd) {
     int flags = fcntl(fd, F_GETFL, 0);
     fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
-
-void setup_server_socket(int& server_fd, int port) {
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd == -1) {
-        throw std::runtime_error("socket failed: " + std::string(strerror(errno)));
-    }
-
-    
-    int opt = 1;
-    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-    set_nonblocking(server_fd);
-
-    struct sockaddr_in address {};
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(port);
-
-    if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) == -1) {
-        throw std::runtime_error("bind failed: " + std::string(strerror(errno)));
-    }
-
-    if (listen(server_fd, 128) == -1) {
-        throw std::runtime_error("listen failed: " + std::string(strerror(errno)));
-    }
-
-    std::cout << "[INFO] Сервер запущен на порту " << port << std::endl;
-}
\ No newline at end of file
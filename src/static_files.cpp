@@ -0,0 +1,162 @@
+#include "static_files.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <strings.h>
+
+namespace {
+
+std::string static_root;
+std::string static_prefix = "/";
+
+const char* content_type_for(const std::string& path) {
+    static const struct {
+        const char* extension;
+        const char* type;
+    } TYPES[] = {
+        { ".html", "text/html; charset=utf-8" },
+        { ".htm", "text/html; charset=utf-8" },
+        { ".css", "text/css" },
+        { ".js", "application/javascript" },
+        { ".json", "application/json" },
+        { ".txt", "text/plain; charset=utf-8" },
+        { ".xml", "application/xml" },
+        { ".svg", "image/svg+xml" },
+        { ".png", "image/png" },
+        { ".jpg", "image/jpeg" },
+        { ".jpeg", "image/jpeg" },
+        { ".gif", "image/gif" },
+        { ".webp", "image/webp" },
+        { ".ico", "image/x-icon" },
+        { ".wasm", "application/wasm" },
+        { ".pdf", "application/pdf" },
+        { ".mp3", "audio/mpeg" },
+        { ".mp4", "video/mp4" },
+        { ".webm", "video/webm" },
+        { ".zip", "application/zip" },
+    };
+    size_t dot = path.rfind('.');
+    if (dot != std::string::npos && path.find('/', dot) == std::string::npos) {
+        for (const auto& known : TYPES) {
+            if (strcasecmp(path.c_str() + dot, known.extension) == 0) {
+                return known.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Путь запроса без строки запроса и %XX; false - путь недопустим:
+// выход за корень через "..", нулевой байт
+bool decode_path(const std::string& target, std::string& path) {
+    size_t end = target.find_first_of("?#");
+    if (end == std::string::npos) end = target.size();
+    for (size_t i = 0; i < end; ++i) {
+        char c = target[i];
+        if (c == '%') {
+            int high = i + 2 < end ? hex_value(target[i + 1]) : -1;
+            int low = i + 2 < end ? hex_value(target[i + 2]) : -1;
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            c = static_cast<char>(high * 16 + low);
+            i += 2;
+        }
+        if (c == '\0') {
+            return false;
+        }
+        path += c;
+    }
+
+    size_t pos = 0;
+    while (pos < path.size()) {
+        size_t slash = path.find('/', pos);
+        if (slash == std::string::npos) slash = path.size();
+        if (path.compare(pos, slash - pos, "..") == 0) {
+            return false;
+        }
+        pos = slash + 1;
+    }
+    return true;
+}
+
+Response error_response(int status) {
+    Response response;
+    response.status = status;
+    response.body = status_text(status);
+    return response;
+}
+
+}
+
+std::string http_date(time_t time) {
+    struct tm parts {};
+    gmtime_r(&time, &parts);
+    char buffer[64];
+    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+    return buffer;
+}
+
+task<Response> static_file_handler(Request& request) {
+    if (static_root.empty() || request.path.compare(0, static_prefix.size(), static_prefix) != 0) {
+        co_return co_await default_handler(request);
+    }
+    if (request.method != "GET") {
+        Response response = error_response(405);
+        response.headers.emplace_back("Allow", "GET");
+        co_return response;
+    }
+
+    std::string path;
+    if (!decode_path(request.path.substr(static_prefix.size()), path)) {
+        co_return error_response(404);
+    }
+    if (path.empty() || path.back() == '/') {
+        path += "index.html";
+    }
+
+    auto file = open_file_body(static_root + "/" + path);
+    if (!file) {
+        co_return error_response(404);
+    }
+
+    Response response;
+    response.content_type = content_type_for(path);
+    response.segments.push_back(BodySegment::file_range(0, static_cast<size_t>(file->size)));
+
+    // Валидатор как у nginx: время изменения и размер
+    char etag[48];
+    std::snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+        static_cast<unsigned long long>(file->mtime), static_cast<unsigned long long>(file->size));
+    response.headers.emplace_back("ETag", etag);
+    response.headers.emplace_back("Last-Modified", http_date(file->mtime));
+    response.headers.emplace_back("Accept-Ranges", "bytes");
+    response.file = std::move(file);
+    co_return response;
+}
+
+void configure_static_files_from_env() {
+    const char* root = std::getenv("SERVER_STATIC_ROOT");
+    if (!root || !*root) {
+        return;
+    }
+    static_root = root;
+    while (static_root.size() > 1 && static_root.back() == '/') {
+        static_root.pop_back();
+    }
+    if (const char* prefix = std::getenv("SERVER_STATIC_PREFIX")) {
+        static_prefix = prefix;
+        if (static_prefix.empty() || static_prefix.back() != '/') {
+            static_prefix += '/';
+        }
+    }
+    request_handler = static_file_handler;
+    std::cout << "[INFO] Статические файлы: " << static_prefix << " -> " << static_root << std::endl;
+}
@@ -1,7 +1,31 @@
 #include "thread_pool.hpp"
+#include "placement.hpp"
+#include "trace.hpp"
 #include <iostream>
+#include <algorithm>
 
-ThreadPool::ThreadPool(size_t num_threads) {
+namespace {
+
+constexpr uint64_t STRIDE = 1 << 20;
+
+thread_local bool worker_thread_flag = false;
+
+}
+
+bool ThreadPool::on_worker_thread() {
+    return worker_thread_flag;
+}
+
+bool ThreadPool::later(const QueuedTask& a, const QueuedTask& b) {
+    if (a.due != b.due) return a.due > b.due;
+    return a.seq > b.seq;
+}
+
+ThreadPool::ThreadPool(size_t num_threads, std::vector<int> cpus, int numa_node) :
+    classes(SCHED_CLASS_COUNT),
+    cpus_(std::move(cpus)),
+    numa_node_(numa_node)
+{
     for (size_t i = 0; i < num_threads; ++i) {
         workers.emplace_back(&ThreadPool::worker_thread, this);
     }
@@ -11,25 +35,66 @@ ThreadPool::~ThreadPool() {
     stop();
 }
 
+size_t ThreadPool::pick_class() const {
+    size_t best = SCHED_CLASS_COUNT;
+    for (size_t i = 0; i < classes.size(); ++i) {
+        if (classes[i].heap.empty()) continue;
+        if (best == SCHED_CLASS_COUNT || classes[i].pass < classes[best].pass) {
+            best = i;
+        }
+    }
+    return best;
+}
+
 void ThreadPool::worker_thread() {
+    worker_thread_flag = true;
+    trace_thread_name("worker");
+    pin_current_thread(cpus_);
+    prefer_local_node(numa_node_);
+
     while (true) {
-        Task task;
+        QueuedTask task;
+        bool expired = false;
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
             condition.wait(lock, [this]() {
-                return stop_ || !tasks.empty();
+                return stop_ || pending_ > 0;
                 });
 
-            if (stop_ && tasks.empty()) {
+            if (stop_ && pending_ == 0) {
                 return;
             }
 
-            task = std::move(tasks.front());
-            tasks.pop();
+            size_t sched_class = pick_class();
+            ClassQueue& queue = classes[sched_class];
+            virtual_time_ = queue.pass;
+            queue.pass += STRIDE / SCHEDULING_CLASSES[sched_class].weight;
+
+            std::pop_heap(queue.heap.begin(), queue.heap.end(), later);
+            task = std::move(queue.heap.back());
+            queue.heap.pop_back();
+            pending_--;
+
+            auto now = SchedClock::now();
+            uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(now - task.enqueued).count();
+            queue.stats.dequeued++;
+            queue.stats.total_wait_us += wait_us;
+            queue.stats.max_wait_us = std::max(queue.stats.max_wait_us, wait_us);
+
+            // Клиент уже не ждёт ответа - обработчик не запускаем
+            expired = now > task.deadline;
+            if (expired) {
+                queue.stats.expired++;
+            }
         }
 
         try {
-            task();
+            if (!expired) {
+                task.task();
+            }
+            else if (task.on_expired) {
+                task.on_expired();
+            }
         }
         catch (const std::exception& e) {
             std::cerr << "[ERROR] Exception in worker thread: " << e.what() << std::endl;
@@ -38,16 +103,40 @@ void ThreadPool::worker_thread() {
 }
 
 void ThreadPool::enqueue(Task task) {
+    enqueue(std::move(task), TaskOptions{});
+}
+
+void ThreadPool::enqueue(Task task, TaskOptions options) {
+    auto now = SchedClock::now();
     {
         std::lock_guard<std::mutex> lock(queue_mutex);
         if (stop_) {
             throw std::runtime_error("enqueue on stopped ThreadPool");
         }
-        tasks.emplace(std::move(task));
+        ClassQueue& queue = classes[std::min(options.sched_class, SCHED_CLASS_COUNT - 1)];
+        // Простаивавший класс не получает накопленный кредит
+        if (queue.heap.empty()) {
+            queue.pass = std::max(queue.pass, virtual_time_);
+        }
+        SchedClock::time_point due = options.deadline != SchedClock::time_point::max()
+            ? options.deadline : now + default_task_budget();
+        queue.heap.push_back(QueuedTask{ std::move(task), std::move(options.on_expired),
+            options.deadline, due, now, seq_++ });
+        std::push_heap(queue.heap.begin(), queue.heap.end(), later);
+        pending_++;
     }
     condition.notify_one();
 }
 
+std::vector<ClassStats> ThreadPool::class_stats() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    std::vector<ClassStats> stats;
+    for (const ClassQueue& queue : classes) {
+        stats.push_back(queue.stats);
+    }
+    return stats;
+}
+
 void ThreadPool::stop() {
     {
         std::lock_guard<std::mutex> lock(queue_mutex);
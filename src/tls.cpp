@@ -0,0 +1,323 @@
+#include "tls.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+
+TlsStats tls_stats;
+
+#ifdef SERVER_WITH_TLS
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+namespace {
+
+const size_t TLS_SMALL_RECORD = 1400;      // запись + заголовки TLS/TCP в одном MSS
+const size_t TLS_LARGE_RECORD = 16384;     // максимальная запись TLS
+const size_t TLS_WARM_BYTES = 1 << 20;     // после 1 МБ окно TCP уже раскрыто
+const time_t TLS_IDLE_RESET = 1;           // после паузы окно снова «холодное»
+
+// Предпочтение h2, если клиент его предлагает
+const unsigned char ALPN_PROTOCOLS[] = "\x02h2\x08http/1.1";
+
+SSL_CTX* context = nullptr;
+
+int select_alpn(SSL*, const unsigned char** out, unsigned char* out_length,
+    const unsigned char* in, unsigned int in_length, void*) {
+    unsigned char* selected = nullptr;
+    if (SSL_select_next_proto(&selected, out_length, ALPN_PROTOCOLS, sizeof(ALPN_PROTOCOLS) - 1,
+        in, in_length) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+std::string last_error() {
+    char buffer[256];
+    ERR_error_string_n(ERR_get_error(), buffer, sizeof(buffer));
+    return buffer;
+}
+
+// Ошибка SSL_* в терминах errno: EAGAIN - ждать готовности сокета
+void set_errno(int error) {
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        errno = EAGAIN;
+    }
+    else if (error != SSL_ERROR_SYSCALL || errno == 0) {
+        errno = ECONNRESET;
+    }
+}
+
+}
+
+std::unique_ptr<TlsSession> TlsSession::create(int fd) {
+    if (!context) {
+        return nullptr;
+    }
+    SSL* ssl = SSL_new(context);
+    if (!ssl) {
+        return nullptr;
+    }
+    SSL_set_fd(ssl, fd);
+    SSL_set_accept_state(ssl);
+    return std::unique_ptr<TlsSession>(new TlsSession(ssl));
+}
+
+TlsSession::TlsSession(ssl_st* ssl) : ssl_(ssl) {}
+
+TlsSession::~TlsSession() {
+    SSL_free(ssl_);
+}
+
+int TlsSession::handshake() {
+    ERR_clear_error();
+    int result = SSL_do_handshake(ssl_);
+    if (result == 1) {
+        established_ = true;
+        wants_write_ = false;
+        if (SSL_session_reused(ssl_)) {
+            ++tls_stats.resumed_handshakes;
+        }
+        else {
+            ++tls_stats.full_handshakes;
+        }
+#ifndef OPENSSL_NO_KTLS
+        ktls_send_ = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+        if (ktls_send_) {
+            ++tls_stats.ktls_connections;
+        }
+#endif
+        return 1;
+    }
+
+    int error = SSL_get_error(ssl_, result);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        wants_write_ = error == SSL_ERROR_WANT_WRITE;
+        return 0;
+    }
+    ++tls_stats.failed_handshakes;
+    return -1;
+}
+
+ssize_t TlsSession::read(char* buffer, size_t length) {
+    ERR_clear_error();
+    size_t received = 0;
+    if (SSL_read_ex(ssl_, buffer, length, &received)) {
+        return static_cast<ssize_t>(received);
+    }
+    int error = SSL_get_error(ssl_, 0);
+    if (error == SSL_ERROR_ZERO_RETURN) {
+        return 0;
+    }
+    set_errno(error);
+    return -1;
+}
+
+size_t TlsSession::record_limit() {
+    time_t now = time(nullptr);
+    if (now - last_write_ > TLS_IDLE_RESET) {
+        warm_bytes_ = 0;
+    }
+    return warm_bytes_ < TLS_WARM_BYTES ? TLS_SMALL_RECORD : TLS_LARGE_RECORD;
+}
+
+ssize_t TlsSession::write_record(const char* data, size_t length) {
+    ERR_clear_error();
+    size_t written = 0;
+    if (SSL_write_ex(ssl_, data, length, &written)) {
+        retry_length_ = 0;
+        warm_bytes_ += written;
+        last_write_ = time(nullptr);
+        return static_cast<ssize_t>(written);
+    }
+    int error = SSL_get_error(ssl_, 0);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        retry_length_ = length;
+    }
+    set_errno(error);
+    return -1;
+}
+
+ssize_t TlsSession::write(const char* data, size_t length) {
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(data);
+    iov.iov_len = length;
+    return writev(&iov, 1);
+}
+
+ssize_t TlsSession::writev(const struct iovec* iov, int count) {
+    // kTLS: записи формирует ядро, шифрованный поток идёт прямо из sendmsg
+    if (ktls_send_) {
+        struct msghdr message {};
+        message.msg_iov = const_cast<struct iovec*>(iov);
+        message.msg_iovlen = count;
+        return sendmsg(SSL_get_fd(ssl_), &message, MSG_NOSIGNAL);
+    }
+
+    // Только поток реактора пишет в TLS
+    static thread_local std::string record;
+
+    size_t total = 0;
+    int index = 0;
+    size_t skip = 0;
+    while (index < count) {
+        size_t available = iov[index].iov_len - skip;
+        if (available == 0) {
+            ++index;
+            skip = 0;
+            continue;
+        }
+
+        size_t limit = retry_length_ ? retry_length_ : record_limit();
+        const char* data = static_cast<const char*>(iov[index].iov_base) + skip;
+        size_t length = std::min(available, limit);
+
+        // Заголовки кадров HTTP/2 и WebSocket не должны уходить
+        // отдельными записями по 9 байт
+        if (available < limit && index + 1 < count) {
+            record.clear();
+            size_t offset = skip;
+            for (int i = index; i < count && record.size() < limit; ++i, offset = 0) {
+                size_t take = std::min(iov[i].iov_len - offset, limit - record.size());
+                record.append(static_cast<const char*>(iov[i].iov_base) + offset, take);
+            }
+            data = record.data();
+            length = record.size();
+        }
+
+        ssize_t sent = write_record(data, length);
+        if (sent < 0) {
+            return total > 0 ? static_cast<ssize_t>(total) : -1;
+        }
+        total += static_cast<size_t>(sent);
+
+        size_t consumed = static_cast<size_t>(sent);
+        while (consumed > 0) {
+            size_t rest = iov[index].iov_len - skip;
+            if (consumed < rest) {
+                skip += consumed;
+                break;
+            }
+            consumed -= rest;
+            ++index;
+            skip = 0;
+        }
+    }
+    return static_cast<ssize_t>(total);
+}
+
+size_t TlsSession::pending() const {
+    return static_cast<size_t>(SSL_pending(ssl_));
+}
+
+void TlsSession::shutdown() {
+    // close_notify без ожидания ответа клиента
+    if (established_) {
+        ERR_clear_error();
+        SSL_shutdown(ssl_);
+    }
+}
+
+bool configure_tls_from_env() {
+    const char* cert = std::getenv("SERVER_TLS_CERT");
+    const char* key = std::getenv("SERVER_TLS_KEY");
+    if (!cert || !key) {
+        return false;
+    }
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    if (!ctx) {
+        throw std::runtime_error("SSL_CTX_new failed: " + last_error());
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS | SSL_OP_NO_RENEGOTIATION |
+        SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_IGNORE_UNEXPECTED_EOF);
+    // Частичная запись для неблокирующего сокета; буферы простаивающих
+    // соединений освобождаются, как и буферы Connection
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+        SSL_MODE_RELEASE_BUFFERS);
+
+    if (SSL_CTX_use_certificate_chain_file(ctx, cert) != 1 ||
+        SSL_CTX_use_PrivateKey_file(ctx, key, SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(ctx) != 1) {
+        std::string error = last_error();
+        SSL_CTX_free(ctx);
+        throw std::runtime_error("TLS certificate/key: " + error);
+    }
+
+    // Общий кеш сессий (session ID) и билеты с ключом контекста:
+    // повторное рукопожатие обходится без обмена ключами по сертификату
+    long cache_size = 20480;
+    if (const char* value = std::getenv("SERVER_TLS_SESSION_CACHE")) {
+        cache_size = std::strtol(value, nullptr, 10);
+    }
+    static const unsigned char SESSION_CONTEXT[] = "async-http-server";
+    SSL_CTX_set_session_id_context(ctx, SESSION_CONTEXT, sizeof(SESSION_CONTEXT) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, cache_size > 0 ? SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_OFF);
+    SSL_CTX_sess_set_cache_size(ctx, cache_size);
+    if (const char* value = std::getenv("SERVER_TLS_TICKETS")) {
+        if (std::string(value) == "0") {
+            SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+        }
+    }
+
+    SSL_CTX_set_alpn_select_cb(ctx, select_alpn, nullptr);
+
+    // BIO сокета пишет через write() без MSG_NOSIGNAL: закрытый клиентом
+    // сокет не должен завершать процесс сигналом
+    std::signal(SIGPIPE, SIG_IGN);
+
+    context = ctx;
+    std::cout << "[INFO] TLS включён, сертификат " << cert << std::endl;
+    return true;
+}
+
+bool tls_enabled() {
+    return context != nullptr;
+}
+
+void log_tls_stats() {
+    if (!context) {
+        return;
+    }
+    std::cout << "[TLS] handshakes full=" << tls_stats.full_handshakes
+        << " resumed=" << tls_stats.resumed_handshakes
+        << " failed=" << tls_stats.failed_handshakes
+        << " ktls=" << tls_stats.ktls_connections
+        << " cached_sessions=" << SSL_CTX_sess_number(context) << std::endl;
+}
+
+#else
+
+// Сборка без OpenSSL: TLS недоступен
+
+std::unique_ptr<TlsSession> TlsSession::create(int) { return nullptr; }
+TlsSession::TlsSession(ssl_st* ssl) : ssl_(ssl) {}
+TlsSession::~TlsSession() = default;
+int TlsSession::handshake() { return -1; }
+ssize_t TlsSession::read(char*, size_t) { errno = ENOTSUP; return -1; }
+ssize_t TlsSession::write(const char*, size_t) { errno = ENOTSUP; return -1; }
+ssize_t TlsSession::writev(const struct iovec*, int) { errno = ENOTSUP; return -1; }
+size_t TlsSession::pending() const { return 0; }
+void TlsSession::shutdown() {}
+
+bool configure_tls_from_env() {
+    if (std::getenv("SERVER_TLS_CERT")) {
+        std::cerr << "[WARN] Сервер собран без OpenSSL, SERVER_TLS_CERT игнорируется" << std::endl;
+    }
+    return false;
+}
+
+bool tls_enabled() {
+    return false;
+}
+
+void log_tls_stats() {}
+
+#endif
@@ -0,0 +1,275 @@
+#include "trace.hpp"
+#include "connection.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t RING_SIZE = 1 << 14;   // событий на поток
+const size_t RING_MASK = RING_SIZE - 1;
+
+// Слот защищён счётчиком (seqlock): seq = индекс + 1 после записи,
+// 0 - во время записи. Читатель копирует поля и сверяет seq повторно.
+struct Slot {
+    std::atomic<uint64_t> seq{ 0 };
+    std::atomic<uint64_t> trace_id{ 0 };
+    std::atomic<uint64_t> timestamp{ 0 };
+    std::atomic<uint64_t> phase{ 0 };
+};
+
+struct TraceEvent {
+    uint64_t trace_id;
+    uint64_t timestamp;
+    TracePhase phase;
+    long tid;
+};
+
+// Кольцо одного потока: пишет только владелец, дамп читает из любого потока
+struct TraceRing {
+    long tid;
+    std::string name;
+    std::atomic<uint64_t> head{ 0 };
+    Slot slots[RING_SIZE];
+
+    void record(uint64_t trace_id, TracePhase phase, uint64_t timestamp) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[index & RING_MASK];
+        slot.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.trace_id.store(trace_id, std::memory_order_relaxed);
+        slot.timestamp.store(timestamp, std::memory_order_relaxed);
+        slot.phase.store(static_cast<uint64_t>(phase), std::memory_order_relaxed);
+        slot.seq.store(index + 1, std::memory_order_release);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    void collect(std::vector<TraceEvent>& events) const {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+        for (uint64_t index = begin; index < end; ++index) {
+            const Slot& slot = slots[index & RING_MASK];
+            if (slot.seq.load(std::memory_order_acquire) != index + 1) {
+                continue;
+            }
+            TraceEvent event;
+            event.trace_id = slot.trace_id.load(std::memory_order_relaxed);
+            event.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+            event.phase = static_cast<TracePhase>(slot.phase.load(std::memory_order_relaxed));
+            event.tid = tid;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // Слот перезаписан во время чтения
+            if (slot.seq.load(std::memory_order_relaxed) != index + 1) {
+                continue;
+            }
+            events.push_back(event);
+        }
+    }
+};
+
+uint64_t sample_every = 0;          // 0 - трассировка выключена
+std::atomic<uint64_t> request_counter{ 0 };
+std::atomic<uint64_t> next_trace_id{ 1 };
+std::string trace_path;
+std::string trace_file = "server-trace.json";
+
+// Кольца живут до конца процесса, даже если поток завершился
+std::mutex rings_mutex;
+std::vector<std::shared_ptr<TraceRing>> rings;
+
+volatile std::sig_atomic_t dump_requested = 0;
+
+thread_local std::shared_ptr<TraceRing> thread_ring;
+thread_local const char* thread_label = "thread";
+
+TraceRing& current_ring() {
+    if (!thread_ring) {
+        thread_ring = std::make_shared<TraceRing>();
+        thread_ring->tid = static_cast<long>(syscall(SYS_gettid));
+        thread_ring->name = thread_label;
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(thread_ring);
+    }
+    return *thread_ring;
+}
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void on_dump_signal(int) {
+    dump_requested = 1;
+}
+
+void append_timestamp(std::string& out, uint64_t timestamp_ns) {
+    // Chrome trace: микросекунды с дробной частью
+    out += std::to_string(timestamp_ns / 1000);
+    out += '.';
+    std::string fraction = std::to_string(timestamp_ns % 1000);
+    out.append(3 - fraction.size(), '0');
+    out += fraction;
+}
+
+}
+
+const char* trace_phase_name(TracePhase phase) {
+    switch (phase) {
+    case TracePhase::ACCEPT: return "accept";
+    case TracePhase::FIRST_BYTE: return "first_byte";
+    case TracePhase::HEADERS_COMPLETE: return "headers_complete";
+    case TracePhase::ENQUEUE: return "enqueue";
+    case TracePhase::DEQUEUE: return "dequeue";
+    case TracePhase::HANDLER_START: return "handler_start";
+    case TracePhase::HANDLER_END: return "handler_end";
+    case TracePhase::NOTIFY: return "notify";
+    case TracePhase::EPOLLOUT_ARMED: return "epollout_armed";
+    case TracePhase::LAST_BYTE: return "last_byte";
+    default: return "unknown";
+    }
+}
+
+void trace_accept(Connection* conn) {
+    conn->accepted_at = sample_every > 0 ? now_ns() : 0;
+}
+
+void trace_start(Connection* conn) {
+    conn->trace_id = 0;
+    if (sample_every == 0) {
+        return;
+    }
+    uint64_t accepted_at = conn->accepted_at;
+    conn->accepted_at = 0;
+    if (request_counter.fetch_add(1, std::memory_order_relaxed) % sample_every != 0) {
+        return;
+    }
+
+    conn->trace_id = next_trace_id.fetch_add(1, std::memory_order_relaxed);
+    if (accepted_at != 0) {
+        trace_record(conn->trace_id, TracePhase::ACCEPT, accepted_at);
+    }
+    trace_record(conn->trace_id, TracePhase::FIRST_BYTE);
+}
+
+void trace_record(uint64_t trace_id, TracePhase phase, uint64_t timestamp) {
+    current_ring().record(trace_id, phase, timestamp != 0 ? timestamp : now_ns());
+}
+
+void trace_thread_name(const char* name) {
+    thread_label = name;
+}
+
+std::string trace_json() {
+    std::vector<std::shared_ptr<TraceRing>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        snapshot = rings;
+    }
+
+    std::vector<TraceEvent> events;
+    for (const auto& ring : snapshot) {
+        ring->collect(events);
+    }
+    std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        return a.trace_id != b.trace_id ? a.trace_id < b.trace_id : a.timestamp < b.timestamp;
+        });
+
+    std::string pid = std::to_string(getpid());
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto begin_event = [&]() {
+        if (!first) out += ",\n";
+        first = false;
+    };
+
+    for (const auto& ring : snapshot) {
+        begin_event();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" +
+            std::to_string(ring->tid) + ",\"args\":{\"name\":\"" + ring->name + "\"}}";
+    }
+
+    // Мгновенные события на дорожке потока, где прошла фаза
+    for (const TraceEvent& event : events) {
+        begin_event();
+        out += "{\"name\":\"";
+        out += trace_phase_name(event.phase);
+        out += "\",\"cat\":\"request\",\"ph\":\"i\",\"s\":\"t\",\"ts\":";
+        append_timestamp(out, event.timestamp);
+        out += ",\"pid\":" + pid + ",\"tid\":" + std::to_string(event.tid) +
+            ",\"args\":{\"request\":" + std::to_string(event.trace_id) + "}}";
+    }
+
+    // Асинхронная дорожка запроса: весь запрос и интервалы между фазами
+    auto async_event = [&](const char* phase, const std::string& name, uint64_t id, uint64_t timestamp) {
+        begin_event();
+        out += "{\"name\":\"" + name + "\",\"cat\":\"request\",\"ph\":\"";
+        out += phase;
+        out += "\",\"id\":" + std::to_string(id) + ",\"ts\":";
+        append_timestamp(out, timestamp);
+        out += ",\"pid\":" + pid + ",\"tid\":0}";
+    };
+    for (size_t begin = 0; begin < events.size();) {
+        size_t end = begin;
+        while (end < events.size() && events[end].trace_id == events[begin].trace_id) {
+            ++end;
+        }
+        uint64_t id = events[begin].trace_id;
+        std::string name = "request " + std::to_string(id);
+        async_event("b", name, id, events[begin].timestamp);
+        for (size_t i = begin; i + 1 < end; ++i) {
+            std::string interval = std::string(trace_phase_name(events[i].phase)) + " -> " +
+                trace_phase_name(events[i + 1].phase);
+            async_event("b", interval, id, events[i].timestamp);
+            async_event("e", interval, id, events[i + 1].timestamp);
+        }
+        async_event("e", name, id, events[end - 1].timestamp);
+        begin = end;
+    }
+
+    out += "]}\n";
+    return out;
+}
+
+bool is_trace_request(const std::string& path) {
+    return !trace_path.empty() && path == trace_path;
+}
+
+bool trace_dump_pending() {
+    return dump_requested != 0;
+}
+
+void dump_trace_to_file() {
+    dump_requested = 0;
+    std::ofstream file(trace_file, std::ios::trunc);
+    if (!file) {
+        std::cerr << "[ERROR] Не удалось открыть " << trace_file << std::endl;
+        return;
+    }
+    file << trace_json();
+    std::cout << "[TRACE] Трасса записана в " << trace_file << std::endl;
+}
+
+void configure_tracing_from_env() {
+    if (const char* value = std::getenv("SERVER_TRACE_SAMPLE")) {
+        sample_every = std::strtoull(value, nullptr, 10);
+    }
+    if (const char* value = std::getenv("SERVER_TRACE_PATH")) {
+        trace_path = value;
+    }
+    if (const char* value = std::getenv("SERVER_TRACE_FILE")) {
+        trace_file = value;
+    }
+    if (sample_every > 0) {
+        std::signal(SIGUSR2, on_dump_signal);
+        std::cout << "[INFO] Трассировка: 1 из " << sample_every << " запросов" << std::endl;
+    }
+}
@@ -0,0 +1,518 @@
+#include "websocket.hpp"
+#include "connection.hpp"
+#include "server.hpp"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+WsHub websocket_hub;
+WebSocketHandler websocket_handler = default_websocket_handler;
+
+namespace {
+
+const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+constexpr int MAX_IOV = 64;
+
+uint32_t rotl(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// SHA-1 нужен только для Sec-WebSocket-Accept
+std::string sha1(const std::string& input) {
+    uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+    std::string data = input;
+    uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+    data.push_back(static_cast<char>(0x80));
+    while (data.size() % 64 != 56) {
+        data.push_back(0);
+    }
+    for (int i = 7; i >= 0; --i) {
+        data.push_back(static_cast<char>(bit_length >> (i * 8)));
+    }
+
+    for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data() + chunk + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5a827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ed9eba1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+            else { f = b ^ c ^ d; k = 0xca62c1d6; }
+
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    std::string digest;
+    for (uint32_t word : h) {
+        for (int i = 3; i >= 0; --i) {
+            digest.push_back(static_cast<char>(word >> (i * 8)));
+        }
+    }
+    return digest;
+}
+
+std::string base64_encode(const std::string& input) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (unsigned char c : input) {
+        buffer = (buffer << 8) | c;
+        bits += 8;
+        while (bits >= 6) {
+            bits -= 6;
+            out.push_back(alphabet[(buffer >> bits) & 0x3f]);
+        }
+    }
+    if (bits > 0) {
+        out.push_back(alphabet[(buffer << (6 - bits)) & 0x3f]);
+    }
+    while (out.size() % 4 != 0) {
+        out.push_back('=');
+    }
+    return out;
+}
+
+// Строгий UTF-8 (RFC 3629): без сверхдлинных форм, суррогатов и
+// кодов выше U+10FFFF. ASCII проверяется по 8 байт
+bool valid_utf8(const char* data, size_t length) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+    while (i < length) {
+        if (i + 8 <= length) {
+            uint64_t chunk;
+            std::memcpy(&chunk, p + i, sizeof(chunk));
+            if ((chunk & 0x8080808080808080ull) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        uint8_t c = p[i];
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+
+        size_t count;
+        uint8_t low = 0x80, high = 0xbf;   // границы второго байта
+        if (c >= 0xc2 && c <= 0xdf) count = 1;
+        else if (c >= 0xe0 && c <= 0xef) {
+            count = 2;
+            if (c == 0xe0) low = 0xa0;
+            else if (c == 0xed) high = 0x9f;
+        }
+        else if (c >= 0xf0 && c <= 0xf4) {
+            count = 3;
+            if (c == 0xf0) low = 0x90;
+            else if (c == 0xf4) high = 0x8f;
+        }
+        else return false;
+
+        if (length - i <= count) return false;
+        if (p[i + 1] < low || p[i + 1] > high) return false;
+        for (size_t k = 2; k <= count; ++k) {
+            if ((p[i + k] & 0xc0) != 0x80) return false;
+        }
+        i += count + 1;
+    }
+    return true;
+}
+
+// Коды, которые можно передать в кадре закрытия (RFC 6455 §7.4):
+// 1005, 1006 и 1015 только для API, 1016-2999 зарезервированы
+bool valid_close_code(uint16_t code) {
+    if (code >= 3000 && code <= 4999) return true;
+    return code >= 1000 && code <= 1014 && code != 1004 && code != 1005 && code != 1006;
+}
+
+bool broadcast_enabled = false;
+
+}
+
+std::string websocket_accept_key(const std::string& client_key) {
+    return base64_encode(sha1(client_key + WEBSOCKET_GUID));
+}
+
+WsFrame websocket_frame(WsOpcode opcode, const char* payload, size_t length) {
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(length + 10);
+    frame->push_back(static_cast<char>(0x80 | opcode));
+
+    // Кадры сервера не маскируются
+    if (length < 126) {
+        frame->push_back(static_cast<char>(length));
+    }
+    else if (length <= 0xffff) {
+        frame->push_back(126);
+        frame->push_back(static_cast<char>(length >> 8));
+        frame->push_back(static_cast<char>(length));
+    }
+    else {
+        frame->push_back(127);
+        for (int i = 7; i >= 0; --i) {
+            frame->push_back(static_cast<char>(static_cast<uint64_t>(length) >> (i * 8)));
+        }
+    }
+    if (length > 0) {
+        frame->append(payload, length);
+    }
+    return frame;
+}
+
+void websocket_mask(char* data, size_t length, const uint8_t mask[4], size_t offset) {
+    // Маска, повёрнутая к позиции offset, размноженная на 8 байт
+    uint8_t rotated[8];
+    for (int i = 0; i < 8; ++i) {
+        rotated[i] = mask[(offset + i) % 4];
+    }
+    uint64_t mask64;
+    std::memcpy(&mask64, rotated, sizeof(mask64));
+
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i mask128 = _mm_set1_epi64x(static_cast<long long>(mask64));
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(chunk, mask128));
+    }
+#endif
+    for (; i + 8 <= length; i += 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, data + i, sizeof(chunk));
+        chunk ^= mask64;
+        std::memcpy(data + i, &chunk, sizeof(chunk));
+    }
+    for (; i < length; ++i) {
+        data[i] ^= rotated[i % 8];
+    }
+}
+
+WsSession::WsSession(std::string topic) :
+    topic_(std::move(topic)),
+    last_seen_(time(nullptr))
+{
+}
+
+bool WsSession::closing() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closing_;
+}
+
+bool WsSession::overflowed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return overflowed_;
+}
+
+size_t WsSession::memory_usage() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Кадры рассылки разделяемые - учитываем только указатели на них
+    return sizeof(WsSession) + input_.capacity() + message_.capacity() + queue_.size() * sizeof(WsFrame);
+}
+
+void WsSession::queue_locked(const WsFrame& frame) {
+    queue_.push_back(frame);
+    queued_bytes_ += frame->size();
+}
+
+bool WsSession::enqueue(const WsFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closing_ || overflowed_) {
+        return false;
+    }
+    if (queued_bytes_ + frame->size() > MAX_QUEUED_BYTES) {
+        overflowed_ = true;
+        return false;
+    }
+    queue_locked(frame);
+    return true;
+}
+
+void WsSession::close_locked(uint16_t code) {
+    if (closing_) return;
+    char payload[2] = { static_cast<char>(code >> 8), static_cast<char>(code) };
+    queue_locked(websocket_frame(WS_CLOSE, payload, sizeof(payload)));
+    closing_ = true;
+}
+
+void WsSession::close(uint16_t code) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_locked(code);
+}
+
+bool WsSession::check_alive(time_t now, int ping_interval, int pong_timeout) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ping_sent_ != 0) {
+        return now - ping_sent_ <= pong_timeout;
+    }
+    if (now - last_seen_ >= ping_interval) {
+        queue_locked(websocket_frame(WS_PING, nullptr, 0));
+        ping_sent_ = now;
+    }
+    return true;
+}
+
+void WsSession::feed(const char* data, size_t length, std::vector<WsMessage>& messages) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closing_) return;
+    input_.append(data, length);
+    last_seen_ = time(nullptr);
+
+    size_t pos = 0;
+    while (!closing_ && input_.size() - pos >= 2) {
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(input_.data() + pos);
+        bool fin = header[0] & 0x80;
+        uint8_t opcode = header[0] & 0x0f;
+        bool masked = header[1] & 0x80;
+        uint64_t payload_length = header[1] & 0x7f;
+
+        size_t header_length = 2 + (payload_length == 126 ? 2 : payload_length == 127 ? 8 : 0) + 4;
+        if (input_.size() - pos < header_length) break;
+
+        if (payload_length == 126) {
+            payload_length = (uint64_t(header[2]) << 8) | header[3];
+        }
+        else if (payload_length == 127) {
+            payload_length = 0;
+            for (int i = 0; i < 8; ++i) {
+                payload_length = (payload_length << 8) | header[2 + i];
+            }
+        }
+
+        // Кадры клиента обязаны быть маскированы
+        if (!masked || (header[0] & 0x70)) {
+            close_locked(1002);
+            break;
+        }
+        if (payload_length > MAX_MESSAGE_SIZE) {
+            close_locked(1009);
+            break;
+        }
+        if (input_.size() - pos - header_length < payload_length) break;
+
+        char* payload = input_.data() + pos + header_length;
+        websocket_mask(payload, payload_length, header + header_length - 4);
+        handle_frame(opcode, fin, payload, payload_length, messages);
+        pos += header_length + payload_length;
+    }
+    input_.erase(0, pos);
+}
+
+void WsSession::handle_frame(uint8_t opcode, bool fin, char* payload, size_t length,
+    std::vector<WsMessage>& messages) {
+    if (opcode >= WS_CLOSE) {
+        // Управляющие кадры: не фрагментируются, не длиннее 125 байт
+        if (!fin || length > 125) {
+            close_locked(1002);
+            return;
+        }
+        if (opcode == WS_PING) {
+            queue_locked(websocket_frame(WS_PONG, payload, length));
+        }
+        else if (opcode == WS_PONG) {
+            ping_sent_ = 0;
+        }
+        else if (opcode == WS_CLOSE) {
+            // Код без причины или код + причина в UTF-8
+            uint16_t code = length >= 2
+                ? static_cast<uint16_t>((uint8_t(payload[0]) << 8) | uint8_t(payload[1])) : 1000;
+            if (length == 1 || !valid_close_code(code)) {
+                close_locked(1002);
+            }
+            else if (length > 2 && !valid_utf8(payload + 2, length - 2)) {
+                close_locked(1007);
+            }
+            else {
+                close_locked(code);
+            }
+        }
+        else {
+            close_locked(1002);
+        }
+        return;
+    }
+
+    if (opcode == WS_CONTINUATION) {
+        if (!in_message_) {
+            close_locked(1002);
+            return;
+        }
+    }
+    else if (opcode == WS_TEXT || opcode == WS_BINARY) {
+        if (in_message_) {
+            close_locked(1002);
+            return;
+        }
+        in_message_ = true;
+        message_opcode_ = opcode;
+    }
+    else {
+        close_locked(1002);
+        return;
+    }
+
+    if (message_.size() + length > MAX_MESSAGE_SIZE) {
+        close_locked(1009);
+        return;
+    }
+    message_.append(payload, length);
+
+    if (fin) {
+        // Текст проверяется после сборки: символ может делиться между кадрами
+        if (message_opcode_ == WS_TEXT && !valid_utf8(message_.data(), message_.size())) {
+            close_locked(1007);
+            return;
+        }
+        WsMessage message;
+        message.data.swap(message_);
+        message.binary = message_opcode_ == WS_BINARY;
+        messages.push_back(std::move(message));
+        in_message_ = false;
+    }
+}
+
+int WsSession::flush(Connection& conn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    while (!queue_.empty()) {
+        struct iovec iov[MAX_IOV];
+        int count = 0;
+        for (auto it = queue_.begin(); it != queue_.end() && count < MAX_IOV; ++it, ++count) {
+            size_t skip = count == 0 ? queue_offset_ : 0;
+            iov[count].iov_base = const_cast<char*>((*it)->data()) + skip;
+            iov[count].iov_len = (*it)->size() - skip;
+        }
+
+        ssize_t sent = conn.write_vector(iov, count);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 1;
+            return -1;
+        }
+
+        size_t consumed = static_cast<size_t>(sent);
+        while (consumed > 0 && !queue_.empty()) {
+            size_t available = queue_.front()->size() - queue_offset_;
+            if (consumed < available) {
+                queue_offset_ += consumed;
+                break;
+            }
+            consumed -= available;
+            queued_bytes_ -= queue_.front()->size();
+            queue_.pop_front();
+            queue_offset_ = 0;
+        }
+    }
+    return 0;
+}
+
+void WsHub::subscribe(const std::string& topic, int fd, std::shared_ptr<WsSession> session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    topics_[topic][fd] = std::move(session);
+    subscriptions_[fd].push_back(topic);
+}
+
+void WsHub::unsubscribe_all(int fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscriptions_.find(fd);
+    if (it == subscriptions_.end()) return;
+
+    for (const std::string& topic : it->second) {
+        auto subscribers = topics_.find(topic);
+        if (subscribers == topics_.end()) continue;
+        subscribers->second.erase(fd);
+        if (subscribers->second.empty()) {
+            topics_.erase(subscribers);
+        }
+    }
+    subscriptions_.erase(it);
+}
+
+size_t WsHub::broadcast(const std::string& topic, const std::string& payload, bool binary) {
+    return broadcast(topic, websocket_frame(binary ? WS_BINARY : WS_TEXT, payload.data(), payload.size()));
+}
+
+size_t WsHub::broadcast(const std::string& topic, const WsFrame& frame) {
+    std::vector<int> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto subscribers = topics_.find(topic);
+        if (subscribers == topics_.end()) return 0;
+
+        ready.reserve(subscribers->second.size());
+        for (auto& [fd, session] : subscribers->second) {
+            // Переполненные очереди тоже помечаются: реактор закроет соединение
+            session->enqueue(frame);
+            ready.push_back(fd);
+        }
+    }
+
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(dirty_mutex_);
+        notify = dirty_.empty();
+        dirty_.insert(dirty_.end(), ready.begin(), ready.end());
+    }
+    if (notify) {
+        reactor.notify(FLUSH_FD, EPOLLOUT);
+    }
+    return ready.size();
+}
+
+void WsHub::mark_dirty(int fd) {
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(dirty_mutex_);
+        notify = dirty_.empty();
+        dirty_.push_back(fd);
+    }
+    if (notify) {
+        reactor.notify(FLUSH_FD, EPOLLOUT);
+    }
+}
+
+std::vector<int> WsHub::take_dirty() {
+    std::lock_guard<std::mutex> lock(dirty_mutex_);
+    std::vector<int> dirty;
+    dirty.swap(dirty_);
+    return dirty;
+}
+
+void default_websocket_handler(Connection& conn, WsMessage& message) {
+    if (!conn.ws) return;
+    if (broadcast_enabled) {
+        websocket_hub.broadcast(conn.ws->topic(), message.data, message.binary);
+        return;
+    }
+    // Очередь отправит реактор сразу после обработки сообщений
+    conn.ws->enqueue(websocket_frame(message.binary ? WS_BINARY : WS_TEXT, message.data.data(), message.data.size()));
+}
+
+void configure_websocket_from_env() {
+    const char* value = std::getenv("SERVER_WS_BROADCAST");
+    broadcast_enabled = value && std::string(value) == "1";
+    if (broadcast_enabled) {
+        std::cout << "[INFO] WebSocket: рассылка сообщений подписчикам темы" << std::endl;
+    }
+}
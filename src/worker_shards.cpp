@@ -0,0 +1,120 @@
+#include "worker_shards.hpp"
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <iostream>
+
+void WorkerShards::start(const PlacementPolicy& policy) {
+    mode_ = policy.shard_mode;
+    match_incoming_cpu_ = policy.match_incoming_cpu;
+
+    for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+        cpu_node_.push_back(cpu_to_node(cpu));
+    }
+
+    const std::vector<int>& cpus = policy.worker_cpus;
+    if (cpus.empty() || mode_ == ShardMode::NONE) {
+        size_t threads = cpus.empty() ? std::thread::hardware_concurrency() : cpus.size();
+        shards_.push_back(std::make_unique<ThreadPool>(threads, cpus));
+        shard_node_.push_back(-1);
+        mode_ = ShardMode::NONE;
+        return;
+    }
+
+    auto bind_cpu = [this](int cpu, size_t shard) {
+        if (cpu < 0) return;
+        if (cpu_shard_.size() <= static_cast<size_t>(cpu)) {
+            cpu_shard_.resize(cpu + 1, NO_SHARD);
+        }
+        cpu_shard_[cpu] = shard;
+    };
+
+    if (mode_ == ShardMode::PER_CORE) {
+        for (int cpu : cpus) {
+            int node = cpu_to_node(cpu);
+            bind_cpu(cpu, shards_.size());
+            shards_.push_back(std::make_unique<ThreadPool>(1, std::vector<int>{ cpu }, node));
+            shard_node_.push_back(node);
+        }
+    }
+    else {
+        std::map<int, std::vector<int>> nodes;
+        for (int cpu : cpus) {
+            nodes[cpu_to_node(cpu)].push_back(cpu);
+        }
+        for (auto& [node, node_cpus] : nodes) {
+            for (int cpu : node_cpus) {
+                bind_cpu(cpu, shards_.size());
+            }
+            shards_.push_back(std::make_unique<ThreadPool>(node_cpus.size(), node_cpus, node));
+            shard_node_.push_back(node);
+        }
+    }
+
+    std::cout << "[INFO] Шардов рабочего пула: " << shards_.size() << std::endl;
+}
+
+void WorkerShards::stop() {
+    for (auto& pool : shards_) {
+        pool->stop();
+    }
+}
+
+std::vector<ClassStats> WorkerShards::class_stats() {
+    std::vector<ClassStats> total(SCHED_CLASS_COUNT);
+    for (auto& pool : shards_) {
+        std::vector<ClassStats> stats = pool->class_stats();
+        for (size_t i = 0; i < SCHED_CLASS_COUNT; ++i) {
+            total[i].dequeued += stats[i].dequeued;
+            total[i].expired += stats[i].expired;
+            total[i].total_wait_us += stats[i].total_wait_us;
+            total[i].max_wait_us = std::max(total[i].max_wait_us, stats[i].max_wait_us);
+        }
+    }
+    return total;
+}
+
+void WorkerShards::log_stats() {
+    std::vector<ClassStats> stats = class_stats();
+    for (size_t i = 0; i < SCHED_CLASS_COUNT; ++i) {
+        if (stats[i].dequeued == 0) continue;
+        std::cout << "[SCHED] class=" << SCHEDULING_CLASSES[i].name
+            << " tasks=" << stats[i].dequeued
+            << " expired=" << stats[i].expired
+            << " avg_wait=" << stats[i].total_wait_us / stats[i].dequeued << " μs"
+            << " max_wait=" << stats[i].max_wait_us << " μs" << std::endl;
+    }
+}
+
+size_t WorkerShards::assign(int fd, int incoming_cpu) const {
+    if (shards_.size() <= 1) {
+        return 0;
+    }
+
+    // Без SO_INCOMING_CPU соединение остаётся на узле реактора
+    int cpu = incoming_cpu >= 0 ? incoming_cpu : current_cpu();
+    if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_shard_.size() && cpu_shard_[cpu] != NO_SHARD) {
+        if (mode_ == ShardMode::PER_NODE || incoming_cpu >= 0) {
+            return cpu_shard_[cpu];
+        }
+    }
+
+    // Ядро вне набора рабочих или PER_CORE без входящего ядра: шарды
+    // узла реактора. В PER_CORE их несколько - соединения делятся между
+    // ними по fd, не покидая узел
+    if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_node_.size()) {
+        int node = cpu_node_[cpu];
+        size_t local = std::count(shard_node_.begin(), shard_node_.end(), node);
+        if (local > 0) {
+            size_t pick = static_cast<size_t>(fd) % local;
+            for (size_t i = 0; i < shard_node_.size(); ++i) {
+                if (shard_node_[i] == node && pick-- == 0) {
+                    return i;
+                }
+            }
+        }
+    }
+
+    // Узел неизвестен (ядро реактора не определено или на его узле нет шардов)
+    return static_cast<size_t>(fd) % shards_.size();
+}
@@ -0,0 +1,170 @@
+#include "range.hpp"
+#include <iostream>
+
+// Проверки разбора Range и If-Range; код возврата - число ошибок
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* expression, int line) {
+    if (!condition) {
+        std::cerr << "[FAIL] range_test.cpp:" << line << ": " << expression << std::endl;
+        failures++;
+    }
+}
+
+#define CHECK(expression) check((expression), #expression, __LINE__)
+
+// Ровно один диапазон [first, last]
+bool single(const std::vector<ByteRange>& ranges, uint64_t first, uint64_t last) {
+    return ranges.size() == 1 && ranges[0].first == first && ranges[0].last == last;
+}
+
+void test_simple() {
+    std::vector<ByteRange> ranges;
+    CHECK(parse_range("bytes=0-99", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 99));
+    CHECK(ranges[0].length() == 100);
+
+    CHECK(parse_range(" Bytes = 10-19 ", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 10, 19));
+
+    // Конец за пределами тела обрезается
+    CHECK(parse_range("bytes=990-2000", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 990, 999));
+}
+
+void test_suffix() {
+    std::vector<ByteRange> ranges;
+    CHECK(parse_range("bytes=-500", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 500, 999));
+
+    // Суффикс длиннее тела - всё тело
+    CHECK(parse_range("bytes=-5000", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 999));
+
+    CHECK(parse_range("bytes=-0", 1000, ranges) == RangeStatus::UNSATISFIABLE);
+    CHECK(parse_range("bytes=-1", 0, ranges) == RangeStatus::UNSATISFIABLE);
+}
+
+void test_open_ended() {
+    std::vector<ByteRange> ranges;
+    CHECK(parse_range("bytes=900-", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 900, 999));
+
+    CHECK(parse_range("bytes=0-", 1, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 0));
+}
+
+void test_overflow() {
+    std::vector<ByteRange> ranges;
+    // Числа больше uint64 насыщаются, а не переполняются
+    CHECK(parse_range("bytes=0-99999999999999999999999", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 999));
+
+    CHECK(parse_range("bytes=99999999999999999999999-", 1000, ranges) == RangeStatus::UNSATISFIABLE);
+    CHECK(parse_range("bytes=18446744073709551615-18446744073709551615", 1000, ranges) ==
+        RangeStatus::UNSATISFIABLE);
+    CHECK(parse_range("bytes=-99999999999999999999999", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 999));
+}
+
+void test_merging() {
+    std::vector<ByteRange> ranges;
+    // Пересекающиеся и соседние
+    CHECK(parse_range("bytes=0-99,50-150,151-200", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 200));
+
+    // Промежуток не больше 80 байт объединяется, больший - нет
+    CHECK(parse_range("bytes=0-9,90-99", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 99));
+    CHECK(parse_range("bytes=0-9,91-99", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(ranges.size() == 2);
+
+    // Порядок клиента не важен: диапазоны сортируются
+    CHECK(parse_range("bytes=500-509,0-9,-10", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(ranges.size() == 3);
+    CHECK(ranges[0].first == 0 && ranges[1].first == 500 && ranges[2].first == 990);
+
+    // Недостижимые диапазоны отбрасываются, остальные остаются
+    CHECK(parse_range("bytes=5000-6000,0-9", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 9));
+}
+
+void test_range_limit() {
+    std::vector<ByteRange> ranges;
+    std::string header = "bytes=";
+    for (int i = 0; i < 64; ++i) {
+        header += (i ? "," : "") + std::to_string(i * 1000) + "-" + std::to_string(i * 1000);
+    }
+    CHECK(parse_range(header, 100000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(ranges.size() == 64);
+
+    // 65-й диапазон - заголовок игнорируется целиком
+    header += ",64000-64000";
+    CHECK(parse_range(header, 100000, ranges) == RangeStatus::IGNORED);
+
+    // Пустые элементы списка не считаются
+    CHECK(parse_range("bytes=,,0-1,,", 1000, ranges) == RangeStatus::SATISFIABLE);
+    CHECK(single(ranges, 0, 1));
+}
+
+void test_unsatisfiable() {
+    std::vector<ByteRange> ranges;
+    CHECK(parse_range("bytes=1000-", 1000, ranges) == RangeStatus::UNSATISFIABLE);
+    CHECK(parse_range("bytes=1000-2000,3000-", 1000, ranges) == RangeStatus::UNSATISFIABLE);
+    CHECK(ranges.empty());
+    CHECK(parse_range("bytes=0-", 0, ranges) == RangeStatus::UNSATISFIABLE);
+}
+
+void test_ignored() {
+    std::vector<ByteRange> ranges;
+    CHECK(parse_range("", 1000, ranges) == RangeStatus::IGNORED);
+    CHECK(parse_range("items=0-9", 1000, ranges) == RangeStatus::IGNORED);
+    CHECK(parse_range("bytes=", 1000, ranges) == RangeStatus::IGNORED);
+    CHECK(parse_range("bytes=5-1", 1000, ranges) == RangeStatus::IGNORED);
+    CHECK(parse_range("bytes=a-b", 1000, ranges) == RangeStatus::IGNORED);
+    CHECK(parse_range("bytes=10", 1000, ranges) == RangeStatus::IGNORED);
+    CHECK(parse_range("bytes=+1-2", 1000, ranges) == RangeStatus::IGNORED);
+    // Одна ошибка отменяет весь заголовок
+    CHECK(parse_range("bytes=0-9,x", 1000, ranges) == RangeStatus::IGNORED);
+}
+
+void test_if_range() {
+    Response response;
+    response.headers.emplace_back("ETag", "\"5f3a-1000\"");
+    response.headers.emplace_back("Last-Modified", "Sun, 06 Nov 1994 08:49:37 GMT");
+
+    CHECK(if_range_matches("\"5f3a-1000\"", response));
+    CHECK(!if_range_matches("\"5f3a-1001\"", response));
+    // Слабый валидатор для If-Range не годится
+    CHECK(!if_range_matches("W/\"5f3a-1000\"", response));
+
+    CHECK(if_range_matches("Sun, 06 Nov 1994 08:49:37 GMT", response));
+    CHECK(!if_range_matches("Sun, 06 Nov 1994 08:49:38 GMT", response));
+
+    // Нет валидатора в ответе - совпадения нет
+    Response bare;
+    CHECK(!if_range_matches("\"5f3a-1000\"", bare));
+    CHECK(!if_range_matches("Sun, 06 Nov 1994 08:49:37 GMT", bare));
+}
+
+}
+
+int main() {
+    test_simple();
+    test_suffix();
+    test_open_ended();
+    test_overflow();
+    test_merging();
+    test_range_limit();
+    test_unsatisfiable();
+    test_ignored();
+    test_if_range();
+
+    if (failures == 0) {
+        std::cout << "[INFO] range_test: OK" << std::endl;
+    }
+    return failures;
+}
@@ -0,0 +1,170 @@
+#include "frame_pool.hpp"
+#include "task.hpp"
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Проверки task<T>, detached_task и пула кадров; код возврата - число ошибок
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* expression, int line) {
+    if (!condition) {
+        std::cerr << "[FAIL] task_test.cpp:" << line << ": " << expression << std::endl;
+        failures++;
+    }
+}
+
+#define CHECK(expression) check((expression), #expression, __LINE__)
+
+task<int> add(int a, int b) {
+    co_return a + b;
+}
+
+task<int> sum_chain(int depth) {
+    if (depth == 0) {
+        co_return 0;
+    }
+    int rest = co_await sum_chain(depth - 1);
+    co_return rest + co_await add(depth, 0);
+}
+
+task<void> fail() {
+    throw std::runtime_error("handler failed");
+    co_return;
+}
+
+task<std::string> catch_failure() {
+    try {
+        co_await fail();
+    }
+    catch (const std::runtime_error& e) {
+        co_return e.what();
+    }
+    co_return "no exception";
+}
+
+// Ручное возобновление: как реактор возобновляет ожидающий обработчик
+struct ManualEvent {
+    std::coroutine_handle<> waiter;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) noexcept { waiter = handle; }
+    void await_resume() const noexcept {}
+};
+
+detached_task run_detached(ManualEvent& event, int& result) {
+    result = co_await sum_chain(10);
+    co_await event;
+    result += 1;
+}
+
+void test_task_values() {
+    ManualEvent event;
+    int result = -1;
+    run_detached(event, result);
+    // detached_task стартует сразу и останавливается на событии
+    CHECK(result == 55);
+    CHECK(event.waiter != nullptr);
+    event.waiter.resume();
+    CHECK(result == 56);
+}
+
+void test_task_exception() {
+    ManualEvent event;
+    std::string message;
+    [](ManualEvent&, std::string& out) -> detached_task {
+        out = co_await catch_failure();
+    }(event, message);
+    CHECK(message == "handler failed");
+}
+
+void test_lazy_task() {
+    // Ленивая задача без co_await не выполняется и освобождает кадр
+    bool started = false;
+    {
+        auto body = [](bool& flag) -> task<void> {
+            flag = true;
+            co_return;
+        };
+        task<void> unused = body(started);
+    }
+    CHECK(!started);
+}
+
+void test_pool_reuse() {
+    uint64_t before = FramePool::heap_allocations();
+    for (int i = 0; i < 1000; ++i) {
+        void* block = FramePool::allocate(300);
+        FramePool::deallocate(block, 300);
+    }
+    CHECK(FramePool::heap_allocations() - before <= 1);
+
+    // Большие кадры идут мимо пула
+    void* large = FramePool::allocate(FramePool::MAX_POOLED_SIZE + 1);
+    FramePool::deallocate(large, FramePool::MAX_POOLED_SIZE + 1);
+}
+
+// Кадры создаются в одном потоке («рабочем»), уничтожаются в другом
+// («реакторе»). Блоки должны возвращаться владельцу: после прогрева
+// пул больше не обращается к operator new
+void test_cross_thread_return() {
+    constexpr int ROUNDS = 200;
+    constexpr int BATCH = 64;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::vector<task<int>> handoff;
+    bool done = false;
+    uint64_t before = FramePool::heap_allocations();
+
+    std::thread worker([&]() {
+        for (int round = 0; round < ROUNDS; ++round) {
+            std::vector<task<int>> batch;
+            for (int i = 0; i < BATCH; ++i) {
+                batch.push_back(add(round, i));
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&]() { return handoff.empty(); });
+            handoff = std::move(batch);
+            ready.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        ready.notify_all();
+    });
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&]() { return !handoff.empty() || done; });
+        if (handoff.empty() && done) break;
+        // Деструкторы task освобождают кадры в этом потоке
+        handoff.clear();
+        ready.notify_all();
+    }
+    worker.join();
+
+    // В обороте не больше двух пакетов: новых блоков не больше, чем
+    // нужно на них, а не по блоку на кадр (ROUNDS * BATCH без возврата)
+    CHECK(FramePool::heap_allocations() - before <= 2 * BATCH);
+}
+
+}
+
+int main() {
+    test_task_values();
+    test_task_exception();
+    test_lazy_task();
+    test_pool_reuse();
+    test_cross_thread_return();
+
+    if (failures == 0) {
+        std::cout << "[INFO] task_test: OK" << std::endl;
+    }
+    return failures;
+}